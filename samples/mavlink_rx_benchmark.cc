@@ -0,0 +1,132 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include <coav/coav.hh>
+
+// Benchmarks the MAVLink receive path of MavQuadCopter. A stand-in
+// autopilot on the loopback interface streams ATTITUDE and
+// LOCAL_POSITION_NED at increasing rates, plus a HEARTBEAT every second.
+
+#define LOCAL_PORT 15560
+#define STEP_SEC 3
+
+static const double rates_hz[] = {50, 100, 1000, 5000};
+
+static void send_msg(int sock, const sockaddr_in &addr, mavlink_message_t &msg)
+{
+    uint8_t buf[MAVLINK_MAX_PACKET_LEN];
+    uint16_t len = mavlink_msg_to_send_buffer(buf, &msg);
+
+    if (sendto(sock, buf, len, 0, (const sockaddr *) &addr, sizeof(addr)) < 0) {
+        perror("sendto");
+    }
+}
+
+static void autopilot(std::atomic<double> &rate_hz, std::atomic<bool> &running)
+{
+    using namespace std::chrono;
+
+    int sock = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock == -1) {
+        perror("socket");
+        exit(EXIT_FAILURE);
+    }
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(LOCAL_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    mavlink_message_t msg;
+    steady_clock::time_point start = steady_clock::now();
+    steady_clock::time_point next = start;
+    steady_clock::time_point next_heartbeat = start;
+
+    while (running) {
+        steady_clock::time_point now = steady_clock::now();
+        uint32_t time_boot_ms = duration_cast<milliseconds>(now - start).count();
+
+        if (now >= next_heartbeat) {
+            mavlink_msg_heartbeat_pack(1, 1, &msg, MAV_TYPE_QUADROTOR,
+                    MAV_AUTOPILOT_ARDUPILOTMEGA,
+                    MAV_MODE_FLAG_CUSTOM_MODE_ENABLED, 0, MAV_STATE_ACTIVE);
+            send_msg(sock, addr, msg);
+            next_heartbeat += seconds(1);
+        }
+
+        mavlink_msg_attitude_pack(1, 1, &msg, time_boot_ms, 0, 0, 0, 0, 0, 0);
+        send_msg(sock, addr, msg);
+
+        mavlink_msg_local_position_ned_pack(1, 1, &msg, time_boot_ms, 0, 0, -5,
+                0, 0, 0);
+        send_msg(sock, addr, msg);
+
+        next += duration_cast<steady_clock::duration>(
+                duration<double>(1.0 / rate_hz));
+        std::this_thread::sleep_until(next);
+    }
+
+    close(sock);
+}
+
+int main()
+{
+    std::atomic<double> rate_hz(rates_hz[0]);
+    std::atomic<bool> running(true);
+
+    MavQuadCopter vehicle(LOCAL_PORT);
+    std::thread autopilot_thread(autopilot, std::ref(rate_hz), std::ref(running));
+
+    std::cout << "rate (Hz)  packets/s  packets/wakeup  parse (us/packet)  "
+              << "I/O thread CPU (%)" << std::endl;
+
+    for (double rate : rates_hz) {
+        rate_hz = rate;
+
+        // Let the rate settle before measuring
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        MavRxStats before = vehicle.get_rx_stats();
+        std::this_thread::sleep_for(std::chrono::seconds(STEP_SEC));
+        MavRxStats after = vehicle.get_rx_stats();
+
+        double packets = after.packets - before.packets;
+        double wakeups = after.wakeups - before.wakeups;
+        double parse_time = after.parse_time - before.parse_time;
+
+        printf("%9.0f  %9.0f  %14.2f  %17.3f  %18.2f\n", rate,
+               packets / STEP_SEC, wakeups ? packets / wakeups : 0.0,
+               packets ? parse_time * 1e6 / packets : 0.0,
+               vehicle.io_cpu_usage() * 100.0);
+    }
+
+    MavRxStats stats = vehicle.get_rx_stats();
+    std::cout << "Largest batch: " << stats.max_batch << " packets" << std::endl;
+
+    running = false;
+    autopilot_thread.join();
+
+    return 0;
+}
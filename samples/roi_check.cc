@@ -0,0 +1,86 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include <coav/coav.hh>
+
+// Checks that the detection region of interest of a hovering vehicle points
+// at its mission waypoint. The waypoint goes through the same geodetic
+// conversion as the one sent by the autopilot, and is placed at bearings and
+// vehicle headings off the north-east diagonal, where mixed up axes show.
+
+#define WAYPOINT_DIST 20.0
+#define ROI_HALF_ANGLE (M_PI / 12.0)
+
+int main(int argc, char **argv)
+{
+    using mavlink_vehicles::global_pos_int;
+    using mavlink_vehicles::local_pos;
+
+    global_pos_int home(-353632610, 1491652300, 584000);
+    double max_error = 0;
+
+    for (int heading_deg = 0; heading_deg < 360; heading_deg += 30) {
+        for (int offset_deg : {-50, -20, 0, 35}) {
+            double heading = heading_deg * M_PI / 180.0;
+            double bearing = heading + offset_deg * M_PI / 180.0;
+
+            // Hovering 5 m above a point north-west of home, facing
+            // 'heading' clockwise from north
+            local_pos vehicle_ned(4, -3, -5);
+            local_pos waypoint_ned(vehicle_ned.x + WAYPOINT_DIST * cos(bearing),
+                                   vehicle_ned.y + WAYPOINT_DIST * sin(bearing),
+                                   vehicle_ned.z);
+
+            VehicleState state;
+            state.ready = true;
+            state.pose.pos = glm::dvec3(vehicle_ned.y, vehicle_ned.x, -vehicle_ned.z);
+            state.pose.set_rot(0, 0, -heading);
+            state.target = mission_target_pose(
+                mavlink_vehicles::math::local_ned_to_global(waypoint_ned, home),
+                home);
+
+            DetectionRoi roi = direction_roi(flight_direction(state),
+                                             ROI_HALF_ANGLE);
+
+            // Waypoint in the vehicle frame: x right, y forward
+            double offset = offset_deg * M_PI / 180.0;
+            PolarVector expected = cartesian_to_spherical(sin(offset),
+                                                          cos(offset), 0);
+
+            double phi = (roi.phi_min + roi.phi_max) / 2.0;
+            double theta = (roi.theta_min + roi.theta_max) / 2.0;
+            double error = fmax(fabs(phi - expected.phi),
+                                fabs(theta - expected.theta));
+
+            if (error > 0.01) {
+                std::cout << "heading " << heading_deg << ", waypoint at "
+                    << offset_deg << " deg: ROI centered " << error * 180.0 / M_PI
+                    << " deg away" << std::endl;
+            }
+
+            max_error = fmax(max_error, error);
+        }
+    }
+
+    std::cout << "max ROI direction error: " << max_error * 180.0 / M_PI
+        << " deg" << std::endl;
+
+    return (max_error <= 0.01) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
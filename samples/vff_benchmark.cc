@@ -0,0 +1,135 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <coav/coav.hh>
+
+// Compares the batched VFF repulsion against the original scalar loop, both
+// in speed and in accuracy.
+
+#define ITERATIONS 2000
+
+static double ref_sigmoid(double x)
+{
+    return 1.0 / (1.0 + exp(-x));
+}
+
+static int ref_sign(double x)
+{
+    return (x > 0) - (x < 0);
+}
+
+// Scalar implementation QuadCopterVFFAvoidance used before batching
+static void repulsion_reference(const std::vector<Obstacle> &obstacles,
+        const VFFParams &p, float &repulse_x, float &repulse_y)
+{
+    repulse_x = 0.0;
+    repulse_y = 0.0;
+
+    for (unsigned int i = 0; i < obstacles.size(); ++i) {
+        float theta_o = obstacles[i].center.y;
+        float phi_o = obstacles[i].center.z;
+        float d_o = obstacles[i].center.x;
+
+        if (fabs(theta_o) < p.min_theta)
+            theta_o = copysign(p.min_theta, theta_o);
+        if (fabs(phi_o) < p.min_phi)
+            phi_o = copysign(p.min_phi, phi_o);
+
+        repulse_x += -p.ko * ref_sign(theta_o) *
+                     ref_sigmoid(p.s1 * (1.0 - fabs(phi_o) / p.s2)) * exp(-p.c3 * d_o) *
+                     exp(-p.c4 * fabs(theta_o));
+        repulse_y += -p.ko * ref_sign(phi_o) *
+                     ref_sigmoid(p.t1 * (1.0 - fabs(theta_o) / p.t2)) * exp(-p.c3 * d_o) *
+                     exp(-p.c4 * fabs(phi_o));
+    }
+}
+
+static std::vector<Obstacle> random_obstacles(std::mt19937 &gen, size_t n)
+{
+    std::uniform_real_distribution<double> dist(0.1, 10.0);
+    std::uniform_real_distribution<double> angle(-M_PI, M_PI);
+    std::vector<Obstacle> obstacles(n);
+
+    for (size_t i = 0; i < n; i++) {
+        obstacles[i].id = i + 1;
+        obstacles[i].center = glm::dvec3(dist(gen), angle(gen), angle(gen));
+    }
+
+    return obstacles;
+}
+
+int main(int argc, char **argv)
+{
+    std::mt19937 gen(42);
+    VFFParams params;
+    VFFObstacles batch;
+    float ref_x, ref_y, x, y;
+
+    // Accuracy: compare the contribution of single obstacles, so errors do
+    // not cancel out in the sum. Counts that are not a multiple of the SIMD
+    // width also go through the scalar tail loop.
+    double max_error = 0;
+    for (const Obstacle &o : random_obstacles(gen, 100000)) {
+        std::vector<Obstacle> single(1, o);
+        repulsion_reference(single, params, ref_x, ref_y);
+
+        for (size_t n : {1, 3, 4, 7}) {
+            batch.assign(std::vector<Obstacle>(n, o));
+            vff_repulsion(batch, params, x, y);
+            x /= n;
+            y /= n;
+
+            max_error = fmax(max_error, fabs(x - ref_x) / fmax(fabs(ref_x), 1e-30));
+            max_error = fmax(max_error, fabs(y - ref_y) / fmax(fabs(ref_y), 1e-30));
+        }
+    }
+
+    std::cout << "max relative error per obstacle: " << max_error << std::endl;
+
+    // Speed
+    for (size_t n : {16, 256, 4096}) {
+        std::vector<Obstacle> obstacles = random_obstacles(gen, n);
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int k = 0; k < ITERATIONS; k++) {
+            repulsion_reference(obstacles, params, ref_x, ref_y);
+        }
+
+        auto t1 = std::chrono::steady_clock::now();
+        for (int k = 0; k < ITERATIONS; k++) {
+            batch.assign(obstacles);
+            vff_repulsion(batch, params, x, y);
+        }
+
+        auto t2 = std::chrono::steady_clock::now();
+
+        double ref_us = std::chrono::duration<double, std::micro>(t1 - t0).count() / ITERATIONS;
+        double batch_us = std::chrono::duration<double, std::micro>(t2 - t1).count() / ITERATIONS;
+
+        std::cout << n << " obstacles: scalar " << ref_us << " us, batched "
+            << batch_us << " us, sum error (" << fabs(x - ref_x) << ", "
+            << fabs(y - ref_y) << ")" << std::endl;
+    }
+
+    return (max_error < 1e-5) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <memory>
 #include <vector>
 
@@ -27,6 +28,25 @@ class CollisionAvoidanceStrategy
 public:
     virtual void avoid(const std::vector<Obstacle> &elements) = 0;
 
+    /**
+     * @brief Capture time of the frame the next detection comes from. Lets
+     * strategies measure the latency of the pipeline.
+     */
+    void set_frame_time(std::chrono::steady_clock::time_point time)
+    {
+        this->frame_time = time;
+    }
+
+    /**
+     * @brief Period at which avoid() should be called. Zero means on every
+     * frame.
+     */
+    virtual std::chrono::steady_clock::duration control_period()
+    {
+        return std::chrono::steady_clock::duration::zero();
+    }
+
 protected:
     std::shared_ptr<VehicleType> vehicle;
+    std::chrono::steady_clock::time_point frame_time;
 };
@@ -0,0 +1,352 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+#include "avoidance/DStarLite.hh"
+
+#define INF std::numeric_limits<float>::infinity()
+
+namespace defaults
+{
+// Bound on the work done by a single plan() call
+const unsigned long max_expansions = 100000;
+}
+
+// Costs are integers, in tenths of a cell, so sums are exact and keys that
+// are equal in theory compare equal. With rounding, a cell tied with the
+// start could be left unexpanded and the start keep a cost that is too low.
+#define STRAIGHT_COST 10
+#define DIAGONAL_COST 14
+
+DStarLite::DStarLite(int width, int height)
+{
+    this->width = width;
+    this->height = height;
+
+    this->g.resize(width * height, INF);
+    this->rhs.resize(width * height, INF);
+    this->blocked.resize(width * height, false);
+    this->exit_cost.resize(width * height, INF);
+    this->in_open.resize(width * height, false);
+    this->open_key.resize(width * height);
+}
+
+void DStarLite::reset(int start_x, int start_y)
+{
+    this->start = start_y * this->width + start_x;
+    this->last_start = this->start;
+    this->km = 0;
+
+    std::fill(this->g.begin(), this->g.end(), INF);
+    std::fill(this->rhs.begin(), this->rhs.end(), INF);
+    std::fill(this->in_open.begin(), this->in_open.end(), false);
+    this->open = decltype(this->open)();
+
+    for (int cell : this->exits) {
+        this->update_vertex(cell);
+    }
+}
+
+void DStarLite::set_exit_cost(int x, int y, float cost)
+{
+    int cell = y * this->width + x;
+    cost = roundf(cost * STRAIGHT_COST);
+
+    if (this->exit_cost[cell] == cost) {
+        return;
+    }
+
+    if (this->exit_cost[cell] == INF) {
+        this->exits.push_back(cell);
+    }
+
+    this->exit_cost[cell] = cost;
+    this->update_vertex(cell);
+}
+
+void DStarLite::clear_exit_costs()
+{
+    std::vector<int> cleared;
+    cleared.swap(this->exits);
+
+    for (int cell : cleared) {
+        this->exit_cost[cell] = INF;
+        this->update_vertex(cell);
+    }
+}
+
+void DStarLite::shift(int dx, int dy)
+{
+    int w = this->width;
+    int h = this->height;
+
+    std::vector<float> old_g(w * h, INF);
+    std::vector<float> old_rhs(w * h, INF);
+    std::vector<float> old_exit(w * h, INF);
+    std::vector<bool> old_blocked(w * h, false);
+    old_g.swap(this->g);
+    old_rhs.swap(this->rhs);
+    old_exit.swap(this->exit_cost);
+    old_blocked.swap(this->blocked);
+
+    this->exits.clear();
+    std::vector<bool> entered(w * h, true);
+
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int ox = x + dx;
+            int oy = y + dy;
+            if (ox < 0 || ox >= w || oy < 0 || oy >= h) {
+                continue;
+            }
+
+            int cell = y * w + x;
+            int old = oy * w + ox;
+            this->g[cell] = old_g[old];
+            this->rhs[cell] = old_rhs[old];
+            this->exit_cost[cell] = old_exit[old];
+            this->blocked[cell] = old_blocked[old];
+            entered[cell] = false;
+
+            if (this->exit_cost[cell] != INF) {
+                this->exits.push_back(cell);
+            }
+        }
+    }
+
+    auto shift_cell = [&](int cell) {
+        int x = glm::clamp(cell % w - dx, 0, w - 1);
+        int y = glm::clamp(cell / w - dy, 0, h - 1);
+        return y * w + x;
+    };
+    this->start = shift_cell(this->start);
+    this->last_start = shift_cell(this->last_start);
+
+    // Keys only depend on the distance between cells and the start, which
+    // moved along with them, so the open list is rebuilt from the
+    // inconsistent cells. Cells next to the ones that left the grid are on
+    // its border, their rhs and the one of new cells have to be updated.
+    std::fill(this->in_open.begin(), this->in_open.end(), false);
+    this->open = decltype(this->open)();
+
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int cell = y * w + x;
+
+            if (entered[cell] || x == 0 || x == w - 1 || y == 0 || y == h - 1) {
+                this->update_vertex(cell);
+            } else if (this->g[cell] != this->rhs[cell]) {
+                Key key = this->calculate_key(cell);
+                this->in_open[cell] = true;
+                this->open_key[cell] = key;
+                this->open.push(Entry{key, cell});
+            }
+        }
+    }
+}
+
+bool DStarLite::is_blocked(int x, int y)
+{
+    return this->blocked[y * this->width + x];
+}
+
+void DStarLite::set_blocked(int x, int y, bool blocked)
+{
+    int cell = y * this->width + x;
+    if (this->blocked[cell] == blocked) {
+        return;
+    }
+
+    this->blocked[cell] = blocked;
+
+    // Costs of every edge of the cell changed
+    int n[8];
+    int count = this->neighbors(cell, n);
+
+    this->update_vertex(cell);
+    for (int i = 0; i < count; i++) {
+        this->update_vertex(n[i]);
+    }
+}
+
+void DStarLite::move_start(int x, int y)
+{
+    this->start = y * this->width + x;
+}
+
+float DStarLite::heuristic(int a, int b)
+{
+    // Octile distance
+    int dx = abs(a % this->width - b % this->width);
+    int dy = abs(a / this->width - b / this->width);
+
+    return STRAIGHT_COST * (dx + dy) +
+        (DIAGONAL_COST - 2 * STRAIGHT_COST) * (dx < dy ? dx : dy);
+}
+
+float DStarLite::cost(int a, int b)
+{
+    if (this->blocked[a] || this->blocked[b]) {
+        return INF;
+    }
+
+    bool diagonal = (a % this->width != b % this->width) &&
+        (a / this->width != b / this->width);
+
+    return diagonal ? DIAGONAL_COST : STRAIGHT_COST;
+}
+
+int DStarLite::neighbors(int cell, int *out)
+{
+    int x = cell % this->width;
+    int y = cell / this->width;
+    int count = 0;
+
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            int nx = x + dx;
+            int ny = y + dy;
+
+            if ((dx || dy) && nx >= 0 && nx < this->width && ny >= 0 &&
+                    ny < this->height) {
+                out[count++] = ny * this->width + nx;
+            }
+        }
+    }
+
+    return count;
+}
+
+DStarLite::Key DStarLite::calculate_key(int cell)
+{
+    float m = fminf(this->g[cell], this->rhs[cell]);
+
+    return Key{m + this->heuristic(this->start, cell) + this->km, m};
+}
+
+void DStarLite::update_vertex(int cell)
+{
+    int n[8];
+    int count = this->neighbors(cell, n);
+    float min = this->blocked[cell] ? INF : this->exit_cost[cell];
+
+    for (int i = 0; i < count; i++) {
+        min = fminf(min, this->cost(cell, n[i]) + this->g[n[i]]);
+    }
+
+    this->rhs[cell] = min;
+
+    if (this->g[cell] != this->rhs[cell]) {
+        Key key = this->calculate_key(cell);
+        this->in_open[cell] = true;
+        this->open_key[cell] = key;
+        this->open.push(Entry{key, cell});
+    } else {
+        this->in_open[cell] = false;
+    }
+}
+
+bool DStarLite::top_key(Key &key)
+{
+    // Drop stale entries
+    while (!this->open.empty()) {
+        const Entry &e = this->open.top();
+        if (this->in_open[e.cell] && this->open_key[e.cell] == e.key) {
+            key = e.key;
+            return true;
+        }
+        this->open.pop();
+    }
+
+    return false;
+}
+
+bool DStarLite::plan()
+{
+    this->km += this->heuristic(this->last_start, this->start);
+    this->last_start = this->start;
+    this->expanded = 0;
+
+    Key top;
+    while (this->top_key(top) &&
+            (top < this->calculate_key(this->start) ||
+             this->rhs[this->start] != this->g[this->start])) {
+
+        if (this->expanded++ >= defaults::max_expansions) {
+            break;
+        }
+
+        int u = this->open.top().cell;
+        this->open.pop();
+        this->in_open[u] = false;
+
+        Key new_key = this->calculate_key(u);
+        if (top < new_key) {
+            this->in_open[u] = true;
+            this->open_key[u] = new_key;
+            this->open.push(Entry{new_key, u});
+            continue;
+        }
+
+        int n[8];
+        int count = this->neighbors(u, n);
+
+        if (this->g[u] > this->rhs[u]) {
+            this->g[u] = this->rhs[u];
+        } else {
+            this->g[u] = INF;
+            this->update_vertex(u);
+        }
+
+        for (int i = 0; i < count; i++) {
+            this->update_vertex(n[i]);
+        }
+    }
+
+    return this->rhs[this->start] != INF;
+}
+
+bool DStarLite::next(int x, int y, int &next_x, int &next_y)
+{
+    int cell = y * this->width + x;
+    int n[8];
+    int count = this->neighbors(cell, n);
+    int best = -1;
+    // Leaving the grid, or stopping on the goal, may be the best move
+    float best_cost = this->blocked[cell] ? INF : this->exit_cost[cell];
+
+    for (int i = 0; i < count; i++) {
+        float c = this->cost(cell, n[i]) + this->g[n[i]];
+        if (c < best_cost) {
+            best_cost = c;
+            best = n[i];
+        }
+    }
+
+    if (best < 0) {
+        return false;
+    }
+
+    next_x = best % this->width;
+    next_y = best / this->width;
+
+    return true;
+}
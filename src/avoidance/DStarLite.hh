@@ -0,0 +1,128 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <queue>
+#include <vector>
+
+/**
+ * D* Lite incremental path planner on an 8-connected grid.
+ *
+ * The search runs from the goal to the start, so when the start moves or
+ * cells change, only the part of the previous search that is affected is
+ * repaired. Moving through a blocked cell costs infinity, straight moves
+ * cost 1 and diagonal moves 1.4.
+ *
+ * The goal is given as exit costs: the cost of reaching it straight from a
+ * cell. A goal inside the grid is a single cell with cost 0, one outside of
+ * it can be reached from the border cells.
+ */
+class DStarLite
+{
+public:
+    DStarLite(int width, int height);
+
+    /**
+     * @brief Discard the search and start a new one. Blocked cells and exit
+     * costs are kept.
+     */
+    void reset(int start_x, int start_y);
+
+    void set_blocked(int x, int y, bool blocked);
+    bool is_blocked(int x, int y);
+
+    /**
+     * @brief Set the cost of reaching the goal straight from a cell, in
+     * cells, infinity by default. It is rounded to a tenth of a cell.
+     */
+    void set_exit_cost(int x, int y, float cost);
+    void clear_exit_costs();
+
+    /**
+     * @brief Move the grid by whole cells, so cell (x, y) becomes
+     * (x - dx, y - dy). The search is kept: cells that enter the grid are
+     * free and unexplored, and only the cells next to the ones that left or
+     * entered it are repaired by the next plan().
+     */
+    void shift(int dx, int dy);
+
+    void move_start(int x, int y);
+
+    /**
+     * @brief Repair the plan after the start moved or cells changed.
+     * @return Whether the goal can be reached.
+     */
+    bool plan();
+
+    /**
+     * @brief Next cell on the path from (x, y) to the goal.
+     * @return False if there is no path or the goal is reached from (x, y).
+     */
+    bool next(int x, int y, int &next_x, int &next_y);
+
+    /**
+     * @brief Number of cells expanded by the last call to plan().
+     */
+    unsigned long get_expanded() { return expanded; }
+
+private:
+    struct Key {
+        float k1;
+        float k2;
+
+        bool operator<(const Key &o) const {
+            return k1 < o.k1 || (k1 == o.k1 && k2 < o.k2);
+        }
+        bool operator==(const Key &o) const {
+            return k1 == o.k1 && k2 == o.k2;
+        }
+    };
+
+    struct Entry {
+        Key key;
+        int cell;
+
+        bool operator>(const Entry &o) const { return o.key < key; }
+    };
+
+    int width;
+    int height;
+    int start = 0;
+    int last_start = 0;
+    float km = 0;
+    unsigned long expanded = 0;
+
+    std::vector<float> g;
+    std::vector<float> rhs;
+    std::vector<bool> blocked;
+    std::vector<float> exit_cost;
+    // Cells with a finite exit cost
+    std::vector<int> exits;
+
+    // Open list with lazy removal: an entry is only valid while the cell is
+    // open and its key matches the one stored for the cell
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    std::vector<bool> in_open;
+    std::vector<Key> open_key;
+
+    float heuristic(int a, int b);
+    float cost(int a, int b);
+    Key calculate_key(int cell);
+    void update_vertex(int cell);
+    bool top_key(Key &key);
+    int neighbors(int cell, int *out);
+};
@@ -0,0 +1,419 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include <glm/glm.hpp>
+
+#include "avoidance/QuadCopterDStarAvoidance.hh"
+#include "common/common.hh"
+#include "common/math.hh"
+#include "common/simd.hh"
+
+namespace defaults
+{
+const double lowest_altitude = 1.0;
+// Period between detour waypoints
+const double wp_period_sec = 0.2;
+// Frames a cell stays occupied once it is not seen anymore
+const uint8_t occupied_frames = 3;
+// The grid follows the vehicle when it gets this close to the border
+const double recenter_margin = 8.0;
+}
+
+QuadCopterDStarAvoidance::QuadCopterDStarAvoidance(
+    std::shared_ptr<MavQuadCopter> quadcopter, double sensor_hfov)
+{
+    this->vehicle = quadcopter;
+    this->sensor_hfov = sensor_hfov;
+
+    int cells = this->grid_size * this->grid_size;
+    this->occupancy.resize(cells, 0);
+    this->inflation.resize(cells, 0);
+    this->hit.resize(cells, false);
+    this->planner.reset(new DStarLite(this->grid_size, this->grid_size));
+}
+
+const QuadCopterDStarAvoidance::PlanStats &
+QuadCopterDStarAvoidance::get_plan_stats()
+{
+    return this->stats;
+}
+
+bool QuadCopterDStarAvoidance::to_cell(double x, double y, int &cx, int &cy)
+{
+    cx = (int) floor((x - this->origin_x) / this->cell_size);
+    cy = (int) floor((y - this->origin_y) / this->cell_size);
+
+    return cx >= 0 && cx < this->grid_size && cy >= 0 && cy < this->grid_size;
+}
+
+glm::dvec3 QuadCopterDStarAvoidance::cell_center(int cx, int cy, double z)
+{
+    return glm::dvec3(this->origin_x + (cx + 0.5) * this->cell_size,
+                      this->origin_y + (cy + 0.5) * this->cell_size, z);
+}
+
+bool QuadCopterDStarAvoidance::recenter(const glm::dvec3 &pos)
+{
+    double half = this->grid_size * this->cell_size / 2.0;
+
+    if (this->has_origin &&
+            fabs(pos.x - (this->origin_x + half)) < half - defaults::recenter_margin &&
+            fabs(pos.y - (this->origin_y + half)) < half - defaults::recenter_margin) {
+        return false;
+    }
+
+    // Move the origin by whole cells, so the occupied cells can be kept
+    int shift_x = 0, shift_y = 0;
+    double new_x = pos.x - half;
+    double new_y = pos.y - half;
+
+    if (this->has_origin) {
+        shift_x = (int) round((new_x - this->origin_x) / this->cell_size);
+        shift_y = (int) round((new_y - this->origin_y) / this->cell_size);
+        new_x = this->origin_x + shift_x * this->cell_size;
+        new_y = this->origin_y + shift_y * this->cell_size;
+    }
+
+    std::vector<uint8_t> old = this->occupancy;
+    int n = this->grid_size;
+
+    std::fill(this->occupancy.begin(), this->occupancy.end(), 0);
+    std::fill(this->inflation.begin(), this->inflation.end(), 0);
+
+    // The planner moves along with the grid and keeps its search
+    this->planner->shift(shift_x, shift_y);
+
+    this->origin_x = new_x;
+    this->origin_y = new_y;
+    this->has_origin = true;
+
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            int ox = x + shift_x;
+            int oy = y + shift_y;
+
+            if (ox >= 0 && ox < n && oy >= 0 && oy < n && old[oy * n + ox]) {
+                this->set_occupied(x, y, true);
+                this->occupancy[y * n + x] = old[oy * n + ox];
+            }
+        }
+    }
+
+    // Cells that were only blocked by the inflation of cells that left the
+    // grid are freed
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            this->planner->set_blocked(x, y, this->inflation[y * n + x] > 0);
+        }
+    }
+
+    return true;
+}
+
+void QuadCopterDStarAvoidance::set_occupied(int cx, int cy, bool occupied)
+{
+    int n = this->grid_size;
+    int r = (int) ceil(this->vehicle_radius / this->cell_size);
+
+    this->occupancy[cy * n + cx] = occupied ? defaults::occupied_frames : 0;
+
+    for (int y = glm::max(cy - r, 0); y <= glm::min(cy + r, n - 1); y++) {
+        for (int x = glm::max(cx - r, 0); x <= glm::min(cx + r, n - 1); x++) {
+            if ((x - cx) * (x - cx) + (y - cy) * (y - cy) > r * r) {
+                continue;
+            }
+
+            uint16_t &count = this->inflation[y * n + x];
+            count += occupied ? 1 : -1;
+
+            // Only transitions reach the planner
+            if (count == (occupied ? 1 : 0)) {
+                this->planner->set_blocked(x, y, occupied);
+            }
+        }
+    }
+}
+
+void QuadCopterDStarAvoidance::update_grid(
+    const std::vector<Obstacle> &obstacles, Pose pose)
+{
+    int n = this->grid_size;
+    double yaw = pose.yaw();
+
+    std::fill(this->hit.begin(), this->hit.end(), false);
+
+    this->obst_x.clear();
+    this->obst_y.clear();
+    this->obst_z.clear();
+
+    for (const Obstacle &o : obstacles) {
+        double r = o.center.x;
+        double theta = o.center.y;
+        double phi = o.center.z;
+
+        if (r > this->sensing_range) {
+            continue;
+        }
+
+        this->obst_x.push_back(r * sin(theta) * cos(phi));
+        this->obst_y.push_back(r * sin(theta) * sin(phi));
+        this->obst_z.push_back(r * cos(theta));
+    }
+
+    // Rotate by the yaw and move to the vehicle position
+    float c = cos(yaw);
+    float s = sin(yaw);
+    const float m[9] = {c, -s, 0, s, c, 0, 0, 0, 1};
+    const float t[3] = {(float) pose.pos.x, (float) pose.pos.y, (float) pose.pos.z};
+    transform_points(this->obst_x.data(), this->obst_y.data(),
+            this->obst_z.data(), this->obst_x.size(), m, t);
+
+    for (size_t i = 0; i < this->obst_x.size(); i++) {
+        int cx, cy;
+        if (fabs(this->obst_z[i] - pose.pos.z) > this->vertical_clearance ||
+                !this->to_cell(this->obst_x[i], this->obst_y[i], cx, cy)) {
+            continue;
+        }
+
+        this->hit[cy * n + cx] = true;
+        if (!this->occupancy[cy * n + cx]) {
+            this->set_occupied(cx, cy, true);
+        }
+        this->occupancy[cy * n + cx] = defaults::occupied_frames;
+    }
+
+    // Occupied cells in view that were not seen are cleared gradually
+    for (int cy = 0; cy < n; cy++) {
+        for (int cx = 0; cx < n; cx++) {
+            int cell = cy * n + cx;
+            if (!this->occupancy[cell] || this->hit[cell]) {
+                continue;
+            }
+
+            glm::dvec3 d = rotate_z(this->cell_center(cx, cy, 0) -
+                    glm::dvec3(pose.pos.x, pose.pos.y, 0), -yaw);
+            double angle = atan2(-d.x, d.y);
+
+            if (glm::length(d) > this->sensing_range ||
+                    fabs(angle) > this->sensor_hfov / 2.0) {
+                continue;
+            }
+
+            if (--this->occupancy[cell] == 0) {
+                this->set_occupied(cx, cy, false);
+            }
+        }
+    }
+}
+
+void QuadCopterDStarAvoidance::set_exit_costs(const glm::dvec3 &target)
+{
+    int n = this->grid_size;
+    int gx, gy;
+
+    this->planner->clear_exit_costs();
+
+    if (this->to_cell(target.x, target.y, gx, gy)) {
+        this->planner->set_exit_cost(gx, gy, 0);
+        return;
+    }
+
+    // Out of the grid, the target is reached through the border cells. The
+    // rest of the way is assumed to be free.
+    for (int i = 0; i < n; i++) {
+        int border[4][2] = {{i, 0}, {i, n - 1}, {0, i}, {n - 1, i}};
+
+        for (auto &cell : border) {
+            glm::dvec3 d = target - this->cell_center(cell[0], cell[1], target.z);
+            this->planner->set_exit_cost(cell[0], cell[1],
+                    glm::length(glm::dvec2(d.x, d.y)) / this->cell_size);
+        }
+    }
+}
+
+void QuadCopterDStarAvoidance::update_goal(const glm::dvec3 &target,
+    bool grid_moved, int sx, int sy)
+{
+    int gx, gy;
+    bool in_grid = this->to_cell(target.x, target.y, gx, gy);
+    glm::dvec3 d = target - this->plan_target;
+
+    // A new target invalidates the whole search
+    if (!this->has_plan || in_grid != this->plan_target_in_grid ||
+            glm::length(glm::dvec2(d.x, d.y)) > this->cell_size) {
+        this->set_exit_costs(target);
+        this->planner->reset(sx, sy);
+        this->plan_target = target;
+        this->plan_target_in_grid = in_grid;
+        this->has_plan = true;
+        this->stats.full_replans++;
+        return;
+    }
+
+    // A target cell moves along with the grid, but the border cells have to
+    // be weighted again
+    if (grid_moved && !in_grid) {
+        this->set_exit_costs(this->plan_target);
+    }
+
+    this->planner->move_start(sx, sy);
+}
+
+void QuadCopterDStarAvoidance::goal_cell(const glm::dvec3 &pos,
+    const glm::dvec3 &target, int &gx, int &gy)
+{
+    if (this->to_cell(target.x, target.y, gx, gy)) {
+        return;
+    }
+
+    // Targets out of the grid are projected on its border
+    double min_x = this->origin_x + this->cell_size / 2.0;
+    double max_x = this->origin_x + (this->grid_size - 0.5) * this->cell_size;
+    double min_y = this->origin_y + this->cell_size / 2.0;
+    double max_y = this->origin_y + (this->grid_size - 0.5) * this->cell_size;
+    glm::dvec3 d = target - pos;
+    double t = 1.0;
+
+    if (pos.x + d.x * t > max_x) t = (max_x - pos.x) / d.x;
+    if (pos.x + d.x * t < min_x) t = (min_x - pos.x) / d.x;
+    if (pos.y + d.y * t > max_y) t = (max_y - pos.y) / d.y;
+    if (pos.y + d.y * t < min_y) t = (min_y - pos.y) / d.y;
+
+    this->to_cell(pos.x + d.x * t, pos.y + d.y * t, gx, gy);
+    gx = glm::clamp(gx, 0, this->grid_size - 1);
+    gy = glm::clamp(gy, 0, this->grid_size - 1);
+}
+
+bool QuadCopterDStarAvoidance::line_is_free(int x0, int y0, int x1, int y1)
+{
+    // Bresenham
+    int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+    int dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+
+    while (true) {
+        if (this->planner->is_blocked(x0, y0)) {
+            return false;
+        }
+
+        if (x0 == x1 && y0 == y1) {
+            return true;
+        }
+
+        int e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+void QuadCopterDStarAvoidance::avoid(const std::vector<Obstacle> &obstacles)
+{
+    using namespace std::chrono;
+
+    if (!vehicle->mav->is_ready()) {
+        return;
+    }
+
+    vehicle->mav->set_autorotate_during_mission(true);
+    vehicle->mav->set_autorotate_during_detour(true);
+
+    // Pose and target from the same snapshot, in local ENU
+    VehicleState state = vehicle->get_state();
+    Pose vehicle_pose = state.pose;
+    glm::dvec3 target = state.target.pos;
+
+    steady_clock::time_point start_time = steady_clock::now();
+
+    // Obstacles are placed with the pose the frame was captured at
+    bool grid_moved = this->recenter(vehicle_pose.pos);
+    this->update_grid(obstacles, vehicle->vehicle_pose_at(this->frame_time));
+
+    int sx, sy, gx, gy;
+    this->to_cell(vehicle_pose.pos.x, vehicle_pose.pos.y, sx, sy);
+    this->update_goal(target, grid_moved, sx, sy);
+
+    // Only used to check whether the way to the target is free
+    this->goal_cell(vehicle_pose.pos, target, gx, gy);
+
+    bool reachable = this->planner->plan();
+
+    this->stats.frames++;
+    this->stats.expanded = this->planner->get_expanded();
+    this->stats.plan_ms =
+        duration<double, std::milli>(steady_clock::now() - start_time).count();
+
+    // Check if we are too close to ground
+    if (vehicle_pose.pos.z < defaults::lowest_altitude) {
+        return;
+    }
+
+    // Nothing in the way, the mission goes on
+    if (this->line_is_free(sx, sy, gx, gy)) {
+        this->wp_x = -1;
+        this->wp_y = -1;
+        return;
+    }
+
+    if (!reachable) {
+        if (!vehicle->mav->is_brake_active()) {
+            vehicle->mav->brake(false);
+            std::cout << "[avoid] state = stopping..." << std::endl;
+        }
+        return;
+    }
+
+    // Follow the plan up to the lookahead distance
+    int x = sx, y = sy;
+    int steps = (int) (this->lookahead / this->cell_size);
+    for (int i = 0; i < steps; i++) {
+        if (!this->planner->next(x, y, x, y)) {
+            break;
+        }
+    }
+
+    if (x == this->wp_x && y == this->wp_y && !vehicle->detour_finished()) {
+        return;
+    }
+
+    steady_clock::time_point now = steady_clock::now();
+    if (duration<double>(now - this->last_wp_time).count() < defaults::wp_period_sec) {
+        return;
+    }
+
+    Pose wp = Pose{this->cell_center(x, y, vehicle_pose.pos.z),
+                   glm::dquat(0, 0, 0, 0)};
+    vehicle->set_target_pose(wp);
+
+    this->wp_x = x;
+    this->wp_y = y;
+    this->last_wp_time = now;
+
+    std::cout << "[avoid] state = detouring..." << std::endl;
+    std::cout << "[avoid] wp (x, y, z): " << wp.pos.x << ", " << wp.pos.y
+              << "," << wp.pos.z << std::endl;
+    std::cout << "[avoid] replan: " << this->stats.expanded << " cells, "
+              << this->stats.plan_ms << " ms" << std::endl;
+}
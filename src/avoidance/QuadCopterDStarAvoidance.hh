@@ -0,0 +1,108 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "avoidance/Avoidance.hh"
+#include "avoidance/DStarLite.hh"
+#include "vehicles/MavQuadCopter.hh"
+
+/**
+ * Local grid planner avoidance.
+ *
+ * Obstacles within the altitude band of the vehicle are accumulated on a
+ * square grid, aligned with the local frame and centered on the vehicle,
+ * which follows it as it flies. Cells that are in view but are not seen
+ * anymore are cleared over a few frames. Occupied cells are inflated by the
+ * vehicle radius.
+ *
+ * D* Lite keeps a plan from the vehicle to the target and each frame only
+ * repairs it: the vehicle moving, cells changing and the grid following the
+ * vehicle are all incremental updates. A target out of the grid is reached
+ * through the border cells, with their distance to the target as exit cost.
+ * The search only starts over when the target changes.
+ * When the straight line to the target is blocked, a point ahead on the
+ * plan is sent as a detour waypoint, which gets the vehicle out of dead
+ * ends that reactive strategies get stuck in.
+ */
+class QuadCopterDStarAvoidance : public CollisionAvoidanceStrategy<MavQuadCopter>
+{
+public:
+    QuadCopterDStarAvoidance(std::shared_ptr<MavQuadCopter> quadcopter,
+            double sensor_hfov = M_PI / 3.0);
+    void avoid(const std::vector<Obstacle> &obstacles) override;
+
+    struct PlanStats {
+        unsigned long frames;
+        unsigned long full_replans;
+        // Cost of the last plan repair
+        unsigned long expanded;
+        double plan_ms;
+    };
+
+    const PlanStats &get_plan_stats();
+
+private:
+    int grid_size = 64;
+    double cell_size = 0.5;
+    double sensor_hfov;
+    double sensing_range = 8.0;
+    double vehicle_radius = 1.0;
+    double vertical_clearance = 1.0;
+    double lookahead = 4.0;
+
+    // Local position of the corner of cell (0, 0)
+    double origin_x = 0;
+    double origin_y = 0;
+    bool has_origin = false;
+
+    std::vector<uint8_t> occupancy;
+    // Number of occupied cells within the vehicle radius of each cell
+    std::vector<uint16_t> inflation;
+    std::vector<bool> hit;
+
+    // Obstacles in range, converted to world coordinates in batch
+    std::vector<float> obst_x;
+    std::vector<float> obst_y;
+    std::vector<float> obst_z;
+
+    std::unique_ptr<DStarLite> planner;
+    bool has_plan = false;
+    // Target the exit costs of the planner were set for
+    glm::dvec3 plan_target;
+    bool plan_target_in_grid = false;
+    int wp_x = -1;
+    int wp_y = -1;
+
+    PlanStats stats = {0, 0, 0, 0.0};
+
+    std::chrono::time_point<std::chrono::steady_clock> last_wp_time;
+
+    bool to_cell(double x, double y, int &cx, int &cy);
+    glm::dvec3 cell_center(int cx, int cy, double z);
+    bool recenter(const glm::dvec3 &pos);
+    void set_occupied(int cx, int cy, bool occupied);
+    void update_grid(const std::vector<Obstacle> &obstacles, Pose pose);
+    void set_exit_costs(const glm::dvec3 &target);
+    void update_goal(const glm::dvec3 &target, bool grid_moved, int sx, int sy);
+    void goal_cell(const glm::dvec3 &pos, const glm::dvec3 &target, int &gx, int &gy);
+    bool line_is_free(int x0, int y0, int x1, int y1);
+};
@@ -0,0 +1,232 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+#include "avoidance/QuadCopterDWAAvoidance.hh"
+#include "common/common.hh"
+#include "common/math.hh"
+#include "common/parallel.hh"
+#include "common/simd.hh"
+
+namespace defaults
+{
+const double lowest_altitude = 1.0;
+// Period between detour waypoints
+const double wp_period_sec = 0.2;
+// Speed changes are limited to what can be done within this time
+const double window_sec = 0.5;
+}
+
+#define INVALID_SCORE (-std::numeric_limits<float>::max())
+
+QuadCopterDWAAvoidance::QuadCopterDWAAvoidance(
+    std::shared_ptr<MavQuadCopter> quadcopter, unsigned int num_speeds,
+    unsigned int num_yaw_rates)
+{
+    this->vehicle = quadcopter;
+    this->num_speeds = glm::max(num_speeds, 2u);
+    this->num_yaw_rates = glm::max(num_yaw_rates, 2u);
+
+    size_t count = this->num_speeds * this->num_yaw_rates;
+    this->speeds.resize(count);
+    this->yaw_rates.resize(count);
+    this->scores.resize(count);
+    this->traj_x.resize(count * this->num_steps);
+    this->traj_y.resize(count * this->num_steps);
+
+    // Integrate every trajectory from the origin, looking forward (+y)
+    double dt = this->horizon / this->num_steps;
+    for (unsigned int i = 0; i < this->num_speeds; i++) {
+        double v = this->max_speed * i / (this->num_speeds - 1);
+
+        for (unsigned int j = 0; j < this->num_yaw_rates; j++) {
+            double w = this->max_yaw_rate *
+                (2.0 * j / (this->num_yaw_rates - 1) - 1.0);
+            size_t k = i * this->num_yaw_rates + j;
+
+            this->speeds[k] = v;
+            this->yaw_rates[k] = w;
+
+            double x = 0, y = 0, a = 0;
+            for (unsigned int s = 0; s < this->num_steps; s++) {
+                a += w * dt;
+                x += -sin(a) * v * dt;
+                y += cos(a) * v * dt;
+                this->traj_x[k * this->num_steps + s] = x;
+                this->traj_y[k * this->num_steps + s] = y;
+            }
+        }
+    }
+}
+
+void QuadCopterDWAAvoidance::project_obstacles(
+    const std::vector<Obstacle> &obstacles)
+{
+    double reach = this->max_speed * this->horizon + this->max_clearance;
+
+    this->obst_x.clear();
+    this->obst_y.clear();
+
+    for (const Obstacle &o : obstacles) {
+        double r = o.center.x;
+        double theta = o.center.y;
+        double phi = o.center.z;
+
+        if (r > reach || fabs(r * cos(theta)) > this->vertical_clearance) {
+            continue;
+        }
+
+        this->obst_x.push_back(r * sin(theta) * cos(phi));
+        this->obst_y.push_back(r * sin(theta) * sin(phi));
+    }
+}
+
+void QuadCopterDWAAvoidance::score(size_t first, size_t last,
+    glm::dvec3 target, double speed)
+{
+    float min_speed = speed - this->max_accel * defaults::window_sec;
+    float max_speed = speed + this->max_accel * defaults::window_sec;
+    float min_clearance2 = this->vehicle_radius * this->vehicle_radius;
+    float target_dist = sqrt(target.x * target.x + target.y * target.y);
+    float max_progress = this->max_speed * this->horizon;
+    const float *ox = this->obst_x.data();
+    const float *oy = this->obst_y.data();
+    size_t num_obst = this->obst_x.size();
+
+    for (size_t k = first; k < last; k++) {
+        float v = this->speeds[k];
+        float w = this->yaw_rates[k];
+
+        // Outside of the dynamic window
+        if (v < min_speed || v > max_speed) {
+            this->scores[k] = INVALID_SCORE;
+            continue;
+        }
+
+        const float *px = &this->traj_x[k * this->num_steps];
+        const float *py = &this->traj_y[k * this->num_steps];
+
+        float clearance2 = std::numeric_limits<float>::max();
+        for (unsigned int s = 0; s < this->num_steps; s++) {
+            clearance2 = glm::min(clearance2,
+                    min_dist2(ox, oy, num_obst, px[s], py[s]));
+            if (clearance2 < min_clearance2) {
+                break;
+            }
+        }
+
+        if (clearance2 < min_clearance2) {
+            this->scores[k] = INVALID_SCORE;
+            continue;
+        }
+
+        float end_x = px[this->num_steps - 1] - target.x;
+        float end_y = py[this->num_steps - 1] - target.y;
+        float progress = (target_dist - sqrtf(end_x * end_x + end_y * end_y)) /
+            max_progress;
+        float clearance = glm::min(sqrtf(clearance2), (float) this->max_clearance) /
+            this->max_clearance;
+        float smoothness = 1.0f - 0.5f *
+            (fabsf(v - this->prev_speed) / this->max_speed +
+             fabsf(w - this->prev_yaw_rate) / (2.0f * this->max_yaw_rate));
+
+        this->scores[k] = this->progress_weight * progress +
+            this->clearance_weight * clearance +
+            this->smoothness_weight * smoothness;
+    }
+}
+
+void QuadCopterDWAAvoidance::avoid(const std::vector<Obstacle> &obstacles)
+{
+    if (!vehicle->mav->is_ready()) {
+        return;
+    }
+
+    vehicle->mav->set_autorotate_during_mission(true);
+    vehicle->mav->set_autorotate_during_detour(true);
+
+    // Pose, target and velocity from the same snapshot, in local ENU
+    VehicleState state = vehicle->get_state();
+    Pose vehicle_pose = state.pose;
+
+    // Check if we are too close to ground
+    if (vehicle_pose.pos.z < defaults::lowest_altitude) {
+        return;
+    }
+
+    this->project_obstacles(obstacles);
+
+    // Nothing within reach, let the mission go on
+    if (this->obst_x.size() == 0) {
+        this->prev_speed = glm::length(state.velocity);
+        this->prev_yaw_rate = 0;
+        return;
+    }
+
+    using namespace std::chrono;
+
+    steady_clock::time_point now = steady_clock::now();
+    if (duration<double>(now - this->last_wp_time).count() < defaults::wp_period_sec) {
+        return;
+    }
+
+    // Target and velocity in the vehicle frame
+    double yaw = vehicle_pose.yaw();
+    glm::dvec3 target = rotate_z(state.target.pos - vehicle_pose.pos, -yaw);
+    double speed = rotate_z(state.velocity, -yaw).y;
+
+    parallel_for(this->scores.size(), [&](size_t begin, size_t end) {
+        this->score(begin, end, target, speed);
+    });
+
+    size_t best = 0;
+    for (size_t k = 1; k < this->scores.size(); k++) {
+        if (this->scores[k] > this->scores[best]) {
+            best = k;
+        }
+    }
+
+    if (this->scores[best] == INVALID_SCORE) {
+        // Every trajectory collides
+        if (!vehicle->mav->is_brake_active()) {
+            vehicle->mav->brake(false);
+            std::cout << "[avoid] state = stopping..." << std::endl;
+        }
+        this->prev_speed = 0;
+        this->prev_yaw_rate = 0;
+        return;
+    }
+
+    this->prev_speed = this->speeds[best];
+    this->prev_yaw_rate = this->yaw_rates[best];
+
+    // A hovering trajectory has no waypoint to go to
+    if (this->speeds[best] == 0) {
+        return;
+    }
+
+    size_t end = (best + 1) * this->num_steps - 1;
+    glm::dvec3 wp_dir = rotate_z(glm::dvec3(this->traj_x[end], this->traj_y[end], 0), yaw);
+    Pose wp = Pose{vehicle_pose.pos + wp_dir, glm::dquat(0, 0, 0, 0)};
+
+    vehicle->set_target_pose(wp);
+    this->last_wp_time = now;
+}
@@ -0,0 +1,86 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "avoidance/Avoidance.hh"
+#include "vehicles/MavQuadCopter.hh"
+
+/**
+ * Dynamic window local planner.
+ *
+ * A grid of constant speed and yaw rate trajectories is sampled over a short
+ * horizon. Trajectories only depend on the grid, so they are computed once,
+ * in the vehicle frame, and the obstacles are used as they come from the
+ * detector. Every trajectory reachable from the current speed is scored by
+ * its clearance to the obstacles, its progress towards the target and how
+ * much it differs from the previous command. Trajectories are scored in
+ * parallel, and the distance to the obstacles is computed with SIMD on
+ * separate x and y arrays.
+ *
+ * While obstacles are within reach, the end of the best trajectory is sent
+ * as a detour waypoint.
+ */
+class QuadCopterDWAAvoidance : public CollisionAvoidanceStrategy<MavQuadCopter>
+{
+public:
+    QuadCopterDWAAvoidance(std::shared_ptr<MavQuadCopter> quadcopter,
+            unsigned int num_speeds = 32, unsigned int num_yaw_rates = 64);
+    void avoid(const std::vector<Obstacle> &obstacles) override;
+
+private:
+    unsigned int num_speeds;
+    unsigned int num_yaw_rates;
+    unsigned int num_steps = 10;
+
+    double max_speed = 3.0;
+    double max_yaw_rate = M_PI / 4.0;
+    double max_accel = 3.0;
+    double horizon = 2.0;
+
+    double vehicle_radius = 1.0;
+    double max_clearance = 3.0;
+    // Obstacles further above or below the vehicle than this are ignored
+    double vertical_clearance = 1.0;
+
+    // Score weights
+    double progress_weight = 1.0;
+    double clearance_weight = 0.5;
+    double smoothness_weight = 0.2;
+
+    // Trajectory points, num_steps per trajectory, in the vehicle frame
+    std::vector<float> traj_x;
+    std::vector<float> traj_y;
+    std::vector<float> speeds;
+    std::vector<float> yaw_rates;
+    std::vector<float> scores;
+
+    // Obstacles projected on the horizontal plane of the vehicle frame
+    std::vector<float> obst_x;
+    std::vector<float> obst_y;
+
+    float prev_speed = 0;
+    float prev_yaw_rate = 0;
+
+    std::chrono::time_point<std::chrono::steady_clock> last_wp_time;
+
+    void project_obstacles(const std::vector<Obstacle> &obstacles);
+    void score(size_t first, size_t last, glm::dvec3 target, double speed);
+};
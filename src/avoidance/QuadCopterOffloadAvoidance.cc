@@ -0,0 +1,105 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <cmath>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "avoidance/QuadCopterOffloadAvoidance.hh"
+#include "common/common.hh"
+
+namespace defaults
+{
+const unsigned int num_sectors = 72;
+const uint16_t min_distance_cm = 10;
+}
+
+QuadCopterOffloadAvoidance::QuadCopterOffloadAvoidance(
+    std::shared_ptr<MavQuadCopter> quadcopter,
+    std::shared_ptr<DepthImagePolarHistDetector> detector)
+{
+    this->vehicle = quadcopter;
+    this->detector = detector;
+}
+
+void QuadCopterOffloadAvoidance::update_geometry(size_t num_slices,
+                                                 double slice_width)
+{
+    this->num_slices = num_slices;
+    this->slice_width = slice_width;
+
+    // Slices are merged when there are more than the message can hold
+    unsigned int merge = (num_slices + defaults::num_sectors - 1) /
+        defaults::num_sectors;
+    unsigned int used_sectors = (num_slices + merge - 1) / merge;
+    double sector_width = glm::degrees(slice_width * merge);
+    double fov = slice_width * num_slices;
+
+    this->slice_sector.resize(num_slices);
+    for (size_t i = 0; i < num_slices; i++) {
+        this->slice_sector[i] = i / merge;
+    }
+
+    // Sectors go clockwise from the offset, which is the center of the
+    // leftmost one. The histogram also goes from left to right.
+    this->msg = {};
+    this->msg.sensor_type = MAV_DISTANCE_SENSOR_UNKNOWN;
+    this->msg.frame = MAV_FRAME_BODY_FRD;
+    this->msg.increment = (uint8_t) glm::clamp(round(sector_width), 1.0, 255.0);
+    this->msg.increment_f = sector_width;
+    this->msg.angle_offset = glm::degrees(-fov / 2.0) + sector_width / 2.0;
+    this->msg.min_distance = defaults::min_distance_cm;
+    this->msg.max_distance = (uint16_t) glm::min(
+        this->detector->get_threshold() * 100.0, UINT16_MAX - 2.0);
+
+    for (unsigned int s = 0; s < defaults::num_sectors; s++) {
+        this->msg.distances[s] = s < used_sectors ?
+            this->msg.max_distance + 1 : UINT16_MAX;
+    }
+}
+
+void QuadCopterOffloadAvoidance::avoid(const std::vector<Obstacle> &obstacles)
+{
+    if (!vehicle->mav->is_ready()) {
+        return;
+    }
+
+    const std::vector<double> &histogram = this->detector->get_histogram();
+    if (histogram.size() == 0) {
+        return;
+    }
+
+    if (histogram.size() != this->num_slices ||
+            this->detector->get_slice_width() != this->slice_width) {
+        this->update_geometry(histogram.size(), this->detector->get_slice_width());
+    }
+
+    // max_distance + 1 means there is nothing in the sector
+    uint16_t none = this->msg.max_distance + 1;
+    for (unsigned int s = 0; s <= this->slice_sector.back(); s++) {
+        this->msg.distances[s] = none;
+    }
+
+    for (size_t i = 0; i < histogram.size(); i++) {
+        double cm = histogram[i] * 100.0;
+        uint16_t d = cm < none ? (uint16_t) cm : none;
+        uint16_t &sector = this->msg.distances[this->slice_sector[i]];
+        sector = d < sector ? d : sector;
+    }
+
+    vehicle->send_obstacle_distance(this->msg);
+}
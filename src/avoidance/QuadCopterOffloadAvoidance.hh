@@ -0,0 +1,52 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "avoidance/Avoidance.hh"
+#include "detection/DepthImagePolarHistDetector.hh"
+#include "vehicles/MavQuadCopter.hh"
+
+/**
+ * Offloads avoidance to the autopilot.
+ *
+ * Instead of steering the vehicle, the polar histogram of the detector is
+ * sent as an OBSTACLE_DISTANCE message on every frame, so the proximity
+ * avoidance of the flight controller can use it. The message layout only
+ * depends on the histogram geometry and is computed once; each frame only
+ * converts the bins to centimeters.
+ */
+class QuadCopterOffloadAvoidance : public CollisionAvoidanceStrategy<MavQuadCopter>
+{
+public:
+    QuadCopterOffloadAvoidance(std::shared_ptr<MavQuadCopter> quadcopter,
+            std::shared_ptr<DepthImagePolarHistDetector> detector);
+    void avoid(const std::vector<Obstacle> &obstacles) override;
+
+private:
+    std::shared_ptr<DepthImagePolarHistDetector> detector;
+
+    mavlink_obstacle_distance_t msg = {};
+    // Message sector of each histogram slice
+    std::vector<unsigned int> slice_sector;
+    size_t num_slices = 0;
+    double slice_width = 0;
+
+    void update_geometry(size_t num_slices, double slice_width);
+};
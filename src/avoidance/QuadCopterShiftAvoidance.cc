@@ -28,6 +28,11 @@ namespace defaults
 const double safe_distance = 8.0;
 const double lowest_altitude = 1.0;
 const double detour_wp_angle = M_PI/3.0;
+const double detour_wp_dist = 2.0;
+// Verified detours keep this far from the edge of the field of view
+const double detour_fov_margin = M_PI / 36.0;
+// Verified detours shorter than this are not worth flying
+const double min_detour_dist = 1.0;
 }
 
 QuadCopterShiftAvoidance::QuadCopterShiftAvoidance(
@@ -36,9 +41,17 @@ QuadCopterShiftAvoidance::QuadCopterShiftAvoidance(
     this->vehicle = quadcopter;
 }
 
+void QuadCopterShiftAvoidance::set_collision_checker(
+    std::shared_ptr<DepthImageCollisionChecker> checker)
+{
+    this->collision_checker = checker;
+}
+
 void QuadCopterShiftAvoidance::avoid(const std::vector<Obstacle> &obstacles)
 {
-    Pose vehicle_pose = vehicle->vehicle_pose();
+    // Pose and mission target from the same snapshot, both in local ENU
+    VehicleState state = vehicle->get_state();
+    Pose vehicle_pose = state.pose;
 
     if (!vehicle->mav->is_ready()) {
         return;
@@ -82,9 +95,10 @@ void QuadCopterShiftAvoidance::avoid(const std::vector<Obstacle> &obstacles)
         }
 
         // Check if the current mission waypoint is closer than the closest obstacle
-        if (mavlink_vehicles::math::ground_dist(
-                vehicle->mav->get_global_position_int(),
-                vehicle->mav->get_mission_waypoint()) <= closest.center.x) {
+        // (horizontal distance, in the local frame)
+        glm::dvec3 to_waypoint = state.target.pos - vehicle_pose.pos;
+        if (glm::length(glm::dvec2(to_waypoint.x, to_waypoint.y)) <=
+                closest.center.x) {
             break;
         }
 
@@ -98,17 +112,51 @@ void QuadCopterShiftAvoidance::avoid(const std::vector<Obstacle> &obstacles)
             glm::dvec3(-sin(vehicle_pose.yaw()), cos(vehicle_pose.yaw()), 0);
 
         // Calculate the direction of the detour waypoint (horizontal rotation
-        // around  lookat vector)
-        glm::dvec3 wp_dir =
-            glm::dvec3(view_dir.x * cos(defaults::detour_wp_angle) -
-                           view_dir.y * sin(defaults::detour_wp_angle),
-                       view_dir.x * sin(defaults::detour_wp_angle) +
-                           view_dir.y * cos(defaults::detour_wp_angle),
-                       0.0);
+        // around  lookat vector). If a collision checker is available, the
+        // path to the waypoint is verified and the other side is tried when
+        // it is blocked. Only what the camera sees can be verified, so the
+        // detour is then turned into the field of view and cut where the
+        // verified part of the path ends.
+        glm::dvec3 wp_dir;
+        double wp_dist = defaults::detour_wp_dist;
+        bool wp_found = false;
+
+        for (double angle : {defaults::detour_wp_angle, -defaults::detour_wp_angle}) {
+            if (!this->collision_checker) {
+                wp_dir = rotate_z(view_dir, angle);
+                wp_found = true;
+                break;
+            }
+
+            double max_angle = glm::max(this->collision_checker->get_hfov() / 2.0 -
+                    defaults::detour_fov_margin, 0.0);
+            wp_dir = rotate_z(view_dir, glm::clamp(angle, -max_angle, max_angle));
+
+            // The sensor looks forward, along +y of the vehicle frame
+            glm::dvec3 wp_sensor = rotate_z(
+                defaults::detour_wp_dist * glm::normalize(wp_dir),
+                -vehicle_pose.yaw());
+
+            wp_dist = this->collision_checker->free_length(glm::dvec3(0, 0, 0),
+                    wp_sensor);
+            if (wp_dist >= defaults::min_detour_dist) {
+                wp_found = true;
+                break;
+            }
+        }
+
+        // Both sides are blocked, stop instead
+        if (!wp_found) {
+            if (!vehicle->mav->is_brake_active()) {
+                vehicle->mav->brake(false);
+                std::cout << "[avoid] state = stopping..." << std::endl;
+            }
+            break;
+        }
 
         // Calculate the global position of the waypoint
         Pose wp =
-            Pose{vehicle_pose.pos + glm::abs(2.0) * glm::normalize(wp_dir),
+            Pose{vehicle_pose.pos + wp_dist * glm::normalize(wp_dir),
                  glm::dquat(0, 0, 0, 0)};
 
         // Send the detour waypoint to the vehicle
@@ -16,11 +16,11 @@
 
 #pragma once
 
-#include <chrono>
 #include <memory>
 #include <vector>
 
 #include "avoidance/Avoidance.hh"
+#include "detection/DepthImageCollisionChecker.hh"
 #include "vehicles/MavQuadCopter.hh"
 
 class QuadCopterShiftAvoidance
@@ -30,9 +30,17 @@ public:
     QuadCopterShiftAvoidance(std::shared_ptr<MavQuadCopter> quadcopter);
     void avoid(const std::vector<Obstacle> &obstacles) override;
 
+    /**
+     * @brief Verify detour waypoints against the latest depth frame before
+     * sending them. Detours are then kept within the field of view, up to
+     * where the path is known to be free. The checker must be updated with
+     * every frame.
+     */
+    void set_collision_checker(
+        std::shared_ptr<DepthImageCollisionChecker> checker);
+
 private:
-    std::chrono::time_point<std::chrono::system_clock> wp_sent_time =
-        std::chrono::system_clock::from_time_t(0);
+    std::shared_ptr<DepthImageCollisionChecker> collision_checker;
 
     enum class avoid_state { moving, detouring };
     avoid_state avoidance_state = avoid_state::moving;
@@ -14,14 +14,21 @@
 // limitations under the License.
 */
 
+#include <chrono>
+#include <cmath>
 #include <iostream>
 
 #include "avoidance/QuadCopterStopAvoidance.hh"
 #include "common/common.hh"
+#include "common/math.hh"
 
 namespace defaults
 {
 const float lowest_altitude = 2.0;
+// Weight of the newest sample on the latency low pass filter
+const double latency_filter = 0.1;
+// Latencies above this, in seconds, mean the frame time is not being set
+const double max_latency = 1.0;
 }
 
 QuadCopterStopAvoidance::QuadCopterStopAvoidance(
@@ -31,6 +38,29 @@ QuadCopterStopAvoidance::QuadCopterStopAvoidance(
     this->trigger_dst = trigger_distance;
 }
 
+void QuadCopterStopAvoidance::set_braking_model(double deceleration,
+    double reaction_time, double margin)
+{
+    this->braking_model = true;
+    this->deceleration = deceleration;
+    this->reaction_time = reaction_time;
+    this->margin = margin;
+}
+
+double QuadCopterStopAvoidance::stopping_distance(const Obstacle &o,
+    const glm::dvec3 &velocity)
+{
+    double theta = o.center.y;
+    double phi = o.center.z;
+    glm::dvec3 dir(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));
+
+    // Only the speed towards the obstacle matters
+    double speed = glm::max(glm::dot(velocity, dir), 0.0);
+
+    return speed * (this->latency + this->reaction_time) +
+        (speed * speed) / (2.0 * this->deceleration) + this->margin;
+}
+
 void QuadCopterStopAvoidance::avoid(const std::vector<Obstacle> &detection)
 {
     if(!this->vehicle) {
@@ -57,10 +87,30 @@ void QuadCopterStopAvoidance::avoid(const std::vector<Obstacle> &detection)
         return;
     }
 
-    // Send the stop command to the vehicle if any obstacle
-    // is closer than or at trigger distance.
+    glm::dvec3 velocity;
+    if (this->braking_model) {
+        using namespace std::chrono;
+
+        // Time from frame capture to now, which is when brake would be sent.
+        // Increases are followed at once, decreases slowly.
+        double sample = duration<double>(steady_clock::now() - this->frame_time).count();
+        if (sample >= 0 && sample < defaults::max_latency) {
+            this->latency = glm::max(sample,
+                glm::mix(this->latency, sample, defaults::latency_filter));
+        }
+
+        // Velocity in the vehicle frame, the one obstacles are given in
+        velocity = rotate_z(vehicle->vehicle_velocity(),
+                            -vehicle->vehicle_pose().yaw());
+    }
+
+    // Send the stop command to the vehicle if any obstacle is closer than
+    // or at trigger distance, or the distance needed to stop before it.
     for (Obstacle o : detection) {
-        if (o.center.x <= this->trigger_dst) {
+        double trigger = this->braking_model ?
+            this->stopping_distance(o, velocity) : this->trigger_dst;
+
+        if (o.center.x <= trigger) {
             if (!this->vehicle->mav->is_brake_active()) {
                 this->vehicle->mav->brake(false);
                 std::cout << "[avoid] state = stopping..." << std::endl;
@@ -31,7 +31,33 @@ public:
 
     void avoid(const std::vector<Obstacle> &detection) override;
 
+    /**
+     * @brief Trigger on the predicted stopping distance instead of the fixed
+     * trigger distance.
+     *
+     * The stopping distance is what the vehicle travels towards an obstacle
+     * during the pipeline latency, measured from the frame time, and the
+     * reaction time of the autopilot, plus the braking distance at the given
+     * deceleration.
+     *
+     * @param deceleration Braking deceleration, in m/s^2.
+     * @param reaction_time Time from the brake command to the start of the
+     * deceleration, in seconds.
+     * @param margin Distance to keep from the obstacles, in meters.
+     */
+    void set_braking_model(double deceleration, double reaction_time = 0.2,
+                           double margin = 1.0);
+
 private:
     double trigger_dst;
+
+    bool braking_model = false;
+    double deceleration = 0;
+    double reaction_time = 0;
+    double margin = 0;
+    // Filtered pipeline latency, in seconds
+    double latency = 0;
+
+    double stopping_distance(const Obstacle &o, const glm::dvec3 &velocity);
 };
 
@@ -14,22 +14,37 @@
 // limitations under the License.
 */
 
+#include <algorithm>
 #include <cerrno>
+#include <limits>
 #include <tuple>
 
 #include "avoidance/QuadCopterVFFAvoidance.hh"
+#include "avoidance/vff.hh"
 #include "common/common.hh"
 #include "common/math.hh"
 
-#define MIN_THETA 0.01
-#define MIN_PHI 0.01
 #define COAV_CALC_PERIOD_MS 100
 #define COAV_TARGET_SEC_MARGIN_M 1.5
+#define COAV_VELOCITY_SAFE_DIST_M 8.0
+#define COAV_VELOCITY_MAX_SPEED_MS 3.0
+#define COAV_VELOCITY_HEADWAY_SEC 2.0
+#define COAV_VELOCITY_MAX_YAW_RATE (M_PI / 4.0)
 
 QuadCopterVFFAvoidance::QuadCopterVFFAvoidance(
-    std::shared_ptr<MavQuadCopter> quadcopter)
+    std::shared_ptr<MavQuadCopter> quadcopter, bool velocity_control)
 {
     this->vehicle = quadcopter;
+    this->velocity_control = velocity_control;
+}
+
+std::chrono::steady_clock::duration QuadCopterVFFAvoidance::control_period()
+{
+    if (this->velocity_control) {
+        return std::chrono::steady_clock::duration::zero();
+    }
+
+    return std::chrono::milliseconds(COAV_CALC_PERIOD_MS);
 }
 
 double get_closest_obst_dist(const std::vector<Obstacle> &obstacles)
@@ -62,7 +77,6 @@ void QuadCopterVFFAvoidance::avoid(const std::vector<Obstacle> &obstacles)
 
     /* Target parameters and variables */
     float kg = 1.0;
-    float ko = 1.0;
     float c1 = 1.0;
     float c2 = 1.0;
 
@@ -73,58 +87,32 @@ void QuadCopterVFFAvoidance::avoid(const std::vector<Obstacle> &obstacles)
     float attract_x = kg * theta_g * (exp(-c1 * dg) + c2);
     float attract_y = kg * phi_g * (exp(-c1 * dg) + c2);
 
-    /* Obstacle parameters and variables */
-    float repulse_x = 0.0;
-    float repulse_y = 0.0;
-    float theta_o = 0.0;
-    float phi_o = 0.0;
-    float d_o = 0.0;
-    float t1 = 1.0;
-    float t2 = 1.0;
-    float s1 = 1.0;
-    float s2 = 1.0;
-    float c3 = 1.0;
-    float c4 = 1.0;
-
-    for (unsigned int i = 0; i < obstacles.size(); ++i) {
-        theta_o = obstacles[i].center.y;
-        phi_o = obstacles[i].center.z;
-        d_o = obstacles[i].center.x;
-
-        /* If the angles are below a specific threshold, consider them as equal
-         * to -/+ threshold. */
-        if (fabs(theta_o) < MIN_THETA)
-            theta_o = copysign(MIN_THETA, theta_o);
-        if (fabs(phi_o) < MIN_PHI)
-            phi_o = copysign(MIN_PHI, phi_o);
-
-        repulse_x += -ko * sign(theta_o) *
-                     sigmoid(s1 * (1.0 - fabs(phi_o) / s2)) * exp(-c3 * d_o) *
-                     exp(-c4 * fabs(theta_o));
-        repulse_y += -ko * sign(phi_o) *
-                     sigmoid(t1 * (1.0 - fabs(theta_o) / t2)) * exp(-c3 * d_o) *
-                     exp(-c4 * fabs(phi_o));
+    /* Obstacle repulsion, evaluated in batches */
+    if (this->obstacle_tracker.update(obstacles)) {
+        this->vff_obstacles.assign(obstacles);
+        vff_repulsion(this->vff_obstacles, this->vff_params, this->repulse_x,
+                      this->repulse_y);
+        this->closest_obst_dist = get_closest_obst_dist(obstacles);
     }
 
     // std::cout << "[QuadCopterVFFAvoidance] "
               // << "Rates: " << (attract_x + repulse_x) << ", "
               // << (attract_y + repulse_y) << std::endl;
 
-    std::tuple<double, double> rates(attract_x + repulse_x, attract_y + repulse_y);
-    double dist = get_closest_obst_dist(obstacles);
+    std::tuple<double, double> rates(attract_x + this->repulse_x,
+                                     attract_y + this->repulse_y);
+    double dist = this->closest_obst_dist;
 
     // std::cout << "Num obstacles, dist: " << obstacles.size() << dist << std::endl;
 
-    // This is the code for drone control
-    using namespace std::chrono;
-
-    // Check if its time to calculate the coav waypoint
-    time_point<system_clock> curr_time = system_clock::now();
-    if (duration_cast<milliseconds>(curr_time - last_calc_time).count() <
-        COAV_CALC_PERIOD_MS) {
+    // Velocity setpoints are streamed by the vehicle, so they are updated
+    // on every frame
+    if (this->velocity_control) {
+        send_coav_velocity(vehicle_pose, std::get<0>(rates), obstacles);
         return;
     }
 
+    // This is the code for drone control
     // Get Vehicle and Target Pose
     PolarVector target_polar_pos = cartesian_to_spherical(
         relative_pose.pos.x, relative_pose.pos.y, relative_pose.pos.z);
@@ -136,8 +124,6 @@ void QuadCopterVFFAvoidance::avoid(const std::vector<Obstacle> &obstacles)
     target_pose = Pose{coav_wp, glm::dquat(0, 0, 0, 0)};
 
     vehicle->set_target_pose(target_pose);
-
-    last_calc_time = curr_time;
 }
 
 glm::dvec3
@@ -176,3 +162,32 @@ QuadCopterVFFAvoidance::calculate_coav_wp(Pose pose, double turn_rate,
     return pose.pos + fabs(R) * glm::normalize(new_waypoint_dir);
 }
 
+void QuadCopterVFFAvoidance::send_coav_velocity(
+    Pose pose, double turn_rate, const std::vector<Obstacle> &obstacles)
+{
+    double closest = std::numeric_limits<double>::max();
+    for (const Obstacle &o : obstacles) {
+        closest = std::min(closest, o.center.x);
+    }
+
+    // Nothing to avoid, let the mission go on
+    if (closest > COAV_VELOCITY_SAFE_DIST_M) {
+        vehicle->stop_target_velocity();
+        return;
+    }
+
+    // Slow down so the closest obstacle is always some time away
+    double speed = glm::clamp(
+        (closest - COAV_TARGET_SEC_MARGIN_M) / COAV_VELOCITY_HEADWAY_SEC, 0.0,
+        COAV_VELOCITY_MAX_SPEED_MS);
+
+    // Fly along the lookat vector rotated by the turn rate, and turn
+    // towards it
+    double yaw = pose.yaw();
+    glm::dvec3 view_dir(-sin(yaw), cos(yaw), 0);
+    glm::dvec3 velocity = speed * rotate_z(view_dir, turn_rate);
+    double yaw_rate = glm::clamp(turn_rate, -COAV_VELOCITY_MAX_YAW_RATE,
+                                 COAV_VELOCITY_MAX_YAW_RATE);
+
+    vehicle->set_target_velocity(velocity, yaw_rate);
+}
@@ -23,20 +23,38 @@
 #include <glm/glm.hpp>
 
 #include "avoidance/Avoidance.hh"
+#include "avoidance/vff.hh"
+#include "common/obstacles.hh"
 #include "vehicles/MavQuadCopter.hh"
 
 class QuadCopterVFFAvoidance : public CollisionAvoidanceStrategy<MavQuadCopter>
 {
 public:
-  QuadCopterVFFAvoidance(std::shared_ptr<MavQuadCopter> quadcopter);
+  /**
+   * @param velocity_control Steer the vehicle with streamed velocity
+   * setpoints, updated on every frame, instead of detour waypoints.
+   */
+  QuadCopterVFFAvoidance(std::shared_ptr<MavQuadCopter> quadcopter,
+                         bool velocity_control = false);
   void avoid(const std::vector<Obstacle> &obstacles) override;
+  std::chrono::steady_clock::duration control_period() override;
 
 private:
   bool coav_enabled = true;
-  std::chrono::time_point<std::chrono::system_clock> last_calc_time =
-      std::chrono::system_clock::from_time_t(0);
+  bool velocity_control = false;
+
+  VFFParams vff_params;
+  VFFObstacles vff_obstacles;
+
+  // Repulsion is only recomputed when the obstacles change
+  ObstacleSetTracker obstacle_tracker;
+  float repulse_x = 0.0;
+  float repulse_y = 0.0;
+  double closest_obst_dist = 0.0;
 
   glm::dvec3 calculate_coav_wp(Pose pose, double turn_rate, double climb_rate,
                                double closest_obst_dist, double target_dist);
+  void send_coav_velocity(Pose pose, double turn_rate,
+                          const std::vector<Obstacle> &obstacles);
 };
 
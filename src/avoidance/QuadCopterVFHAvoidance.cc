@@ -0,0 +1,292 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+#include "avoidance/QuadCopterVFHAvoidance.hh"
+#include "common/common.hh"
+#include "common/math.hh"
+
+namespace defaults
+{
+const double lowest_altitude = 1.0;
+}
+
+QuadCopterVFHAvoidance::QuadCopterVFHAvoidance(
+    std::shared_ptr<MavQuadCopter> quadcopter, double sensor_hfov,
+    unsigned int num_sectors)
+{
+    this->vehicle = quadcopter;
+    this->sensor_hfov = sensor_hfov;
+    this->num_sectors = glm::max(num_sectors, 4u);
+    this->sector_width = 2.0 * M_PI / this->num_sectors;
+
+    this->blocked.resize(this->num_sectors, false);
+    this->sector_dist.resize(this->num_sectors);
+    this->sector_seen.resize(this->num_sectors);
+}
+
+// Headings are measured counterclockwise from the vehicle yaw reference, so
+// a heading equal to the yaw points forward
+int QuadCopterVFHAvoidance::heading_to_sector(double heading)
+{
+    double h = fmod(heading, 2.0 * M_PI);
+    h = h < 0 ? h + 2.0 * M_PI : h;
+
+    return ((int) (h / this->sector_width + 0.5)) % this->num_sectors;
+}
+
+double QuadCopterVFHAvoidance::sector_to_heading(int sector)
+{
+    return sector * this->sector_width;
+}
+
+unsigned int QuadCopterVFHAvoidance::sector_diff(int a, int b)
+{
+    unsigned int d = abs(a - b);
+    return glm::min(d, this->num_sectors - d);
+}
+
+void QuadCopterVFHAvoidance::update_histogram(
+    const std::vector<Obstacle> &obstacles, double yaw, double max_dist)
+{
+    int n = this->num_sectors;
+
+    std::fill(this->sector_dist.begin(), this->sector_dist.end(),
+              std::numeric_limits<double>::max());
+
+    // Each obstacle blocks every heading that would bring the vehicle
+    // within its radius of it
+    for (const Obstacle &o : obstacles) {
+        double dist = o.center.x;
+        if (dist >= this->free_distance || dist > max_dist) {
+            continue;
+        }
+
+        double heading = yaw + o.center.z - M_PI / 2.0;
+        double enlarge = asin(glm::min(this->vehicle_radius / dist, 1.0));
+        int first = this->heading_to_sector(heading - enlarge);
+        int span = (int) ceil(2.0 * enlarge / this->sector_width);
+
+        for (int k = 0; k <= glm::min(span, n - 1); k++) {
+            double &d = this->sector_dist[(first + k) % n];
+            d = glm::min(d, dist);
+        }
+    }
+
+    // Only the sectors seen by the sensor are updated
+    int first_seen = this->heading_to_sector(yaw - this->sensor_hfov / 2.0);
+    int num_seen = (int) (this->sensor_hfov / this->sector_width);
+
+    for (int k = 0; k <= glm::min(num_seen, n - 1); k++) {
+        int s = (first_seen + k) % n;
+
+        if (this->sector_dist[s] < this->block_distance) {
+            this->blocked[s] = true;
+        } else if (this->sector_dist[s] > this->free_distance) {
+            this->blocked[s] = false;
+        }
+    }
+}
+
+bool QuadCopterVFHAvoidance::forget_unseen(double yaw,
+        std::chrono::steady_clock::time_point now)
+{
+    using namespace std::chrono;
+
+    int n = this->num_sectors;
+
+    int first_seen = this->heading_to_sector(yaw - this->sensor_hfov / 2.0);
+    int num_seen = (int) (this->sensor_hfov / this->sector_width);
+
+    for (int k = 0; k <= glm::min(num_seen, n - 1); k++) {
+        this->sector_seen[(first_seen + k) % n] = now;
+    }
+
+    // Blocked sectors that have not been seen for a while are freed
+    bool changed = false;
+    for (int s = 0; s < n; s++) {
+        if (this->blocked[s] && duration<double>(now -
+                    this->sector_seen[s]).count() > this->sector_memory_sec) {
+            this->blocked[s] = false;
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+void QuadCopterVFHAvoidance::find_candidates(int target_sector)
+{
+    int n = this->num_sectors;
+    int smax = this->max_valley_sectors;
+
+    this->candidates.clear();
+
+    // Start the scan on a blocked sector so valleys do not wrap around it
+    int start = -1;
+    for (int k = 0; k < n; k++) {
+        if (this->blocked[k]) {
+            start = k;
+            break;
+        }
+    }
+
+    if (start < 0) {
+        this->candidates.push_back(target_sector);
+        return;
+    }
+
+    int k = 1;
+    while (k < n) {
+        if (this->blocked[(start + k) % n]) {
+            k++;
+            continue;
+        }
+
+        int right = k;
+        while (k < n && !this->blocked[(start + k) % n]) {
+            k++;
+        }
+        int left = k - 1;
+        int width = left - right + 1;
+
+        if (width > smax) {
+            // Wide valley: its borders, kept clear of the obstacles, and
+            // the target direction if it lies inside
+            this->candidates.push_back((start + right + smax / 2) % n);
+            this->candidates.push_back((start + left - smax / 2 + n) % n);
+
+            int t = (target_sector - start + n) % n;
+            if (t >= right + smax / 2 && t <= left - smax / 2) {
+                this->candidates.push_back(target_sector);
+            }
+        } else {
+            // Narrow valley: its center
+            this->candidates.push_back((start + (right + left) / 2) % n);
+        }
+    }
+}
+
+int QuadCopterVFHAvoidance::select_sector(int target_sector, int heading_sector)
+{
+    int previous = this->previous_sector < 0 ? heading_sector : this->previous_sector;
+    int best = -1;
+    double best_cost = std::numeric_limits<double>::max();
+
+    for (int c : this->candidates) {
+        double cost = this->target_weight * this->sector_diff(c, target_sector) +
+                      this->heading_weight * this->sector_diff(c, heading_sector) +
+                      this->previous_weight * this->sector_diff(c, previous);
+
+        if (cost < best_cost) {
+            best_cost = cost;
+            best = c;
+        }
+    }
+
+    return best;
+}
+
+void QuadCopterVFHAvoidance::avoid(const std::vector<Obstacle> &obstacles)
+{
+    if (!vehicle->mav->is_ready()) {
+        return;
+    }
+
+    vehicle->mav->set_autorotate_during_mission(true);
+    vehicle->mav->set_autorotate_during_detour(false);
+
+    // Pose and target from the same snapshot, in local ENU
+    VehicleState state = vehicle->get_state();
+    Pose vehicle_pose = state.pose;
+    glm::dvec3 target_dir = state.target.pos - vehicle_pose.pos;
+    double yaw = vehicle_pose.yaw();
+
+    // The forward direction is (-sin(yaw), cos(yaw))
+    int target_sector = this->heading_to_sector(atan2(-target_dir.x, target_dir.y));
+    int heading_sector = this->heading_to_sector(yaw);
+
+    // Obstacles are placed with the heading the frame was captured at
+    double capture_yaw = vehicle->vehicle_pose_at(this->frame_time).yaw();
+
+    if (this->forget_unseen(capture_yaw, std::chrono::steady_clock::now())) {
+        this->selection_valid = false;
+    }
+
+    // The histogram is indexed by world heading, so the same obstacles seen
+    // with the same heading leave it as it is
+    bool changed = this->obstacle_tracker.update(obstacles);
+    if (changed || heading_sector != this->histogram_heading ||
+            target_sector != this->histogram_target) {
+        // Obstacles behind the target do not need to be avoided
+        this->update_histogram(obstacles, capture_yaw, glm::length(target_dir));
+        this->histogram_heading = heading_sector;
+        this->histogram_target = target_sector;
+        this->selection_valid = false;
+    }
+
+    // Check if we are too close to ground
+    if (vehicle_pose.pos.z < defaults::lowest_altitude) {
+        return;
+    }
+
+    if (!this->selection_valid) {
+        this->find_candidates(target_sector);
+        this->selected_sector = this->select_sector(target_sector, heading_sector);
+        this->selection_valid = true;
+    }
+    int sector = this->selected_sector;
+
+    if (sector < 0) {
+        // Nowhere to go
+        if (!vehicle->mav->is_brake_active()) {
+            vehicle->mav->brake(false);
+            std::cout << "[avoid] state = stopping..." << std::endl;
+        }
+        return;
+    }
+
+    this->previous_sector = sector;
+
+    if (sector == target_sector) {
+        // Path to the target is clear, the mission goes on
+        this->detour_sector = -1;
+        return;
+    }
+
+    // Keep the current detour while it is still the best option
+    if (sector == this->detour_sector && !vehicle->detour_finished()) {
+        return;
+    }
+
+    double heading = this->sector_to_heading(sector);
+    glm::dvec3 wp_dir = glm::dvec3(-sin(heading), cos(heading), 0.0);
+    Pose wp = Pose{vehicle_pose.pos + this->detour_distance * wp_dir,
+                   glm::dquat(0, 0, 0, 0)};
+
+    vehicle->set_target_pose(wp);
+    this->detour_sector = sector;
+
+    std::cout << "[avoid] state = detouring..." << std::endl;
+    std::cout << "[avoid] wp (x, y, z): " << wp.pos.x << ", " << wp.pos.y
+              << "," << wp.pos.z << std::endl;
+}
@@ -0,0 +1,98 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <memory>
+#include <chrono>
+#include <vector>
+
+#include "avoidance/Avoidance.hh"
+#include "common/obstacles.hh"
+#include "vehicles/MavQuadCopter.hh"
+
+/**
+ * Vector Field Histogram (VFH+) avoidance.
+ *
+ * Obstacles are enlarged by the vehicle radius and accumulated on a binary
+ * polar histogram of headings around the vehicle. Sectors become blocked
+ * when something is closer than 'block_distance' and only become free again
+ * when nothing is closer than 'free_distance'. Sectors out of the sensor
+ * field of view keep their last state for 'sector_memory_sec', then are
+ * freed, so a heading that was blocked once does not stay blocked after it
+ * turned out of view.
+ *
+ * Runs of free sectors (valleys) give the candidate headings, which are
+ * weighted by their distance to the target direction, to the current
+ * heading and to the previous choice. When the cheapest heading is not the
+ * direction of the target, a detour waypoint is sent along it.
+ *
+ * The histogram is only updated when the obstacles, the heading or the
+ * target direction changed, and the selection only when the histogram did.
+ */
+class QuadCopterVFHAvoidance : public CollisionAvoidanceStrategy<MavQuadCopter>
+{
+public:
+    QuadCopterVFHAvoidance(std::shared_ptr<MavQuadCopter> quadcopter,
+            double sensor_hfov = M_PI / 3.0, unsigned int num_sectors = 72);
+    void avoid(const std::vector<Obstacle> &obstacles) override;
+
+private:
+    double sensor_hfov;
+    unsigned int num_sectors;
+    double sector_width;
+
+    // Binary polar histogram, indexed by world heading
+    std::vector<bool> blocked;
+    std::vector<double> sector_dist;
+    // When each sector was last in the sensor field of view
+    std::vector<std::chrono::steady_clock::time_point> sector_seen;
+    std::vector<int> candidates;
+
+    int previous_sector = -1;
+    int detour_sector = -1;
+
+    // Inputs of the last histogram update and selection
+    ObstacleSetTracker obstacle_tracker;
+    int histogram_heading = -1;
+    int histogram_target = -1;
+    bool selection_valid = false;
+    int selected_sector = -1;
+
+    double block_distance = 4.0;
+    double free_distance = 5.0;
+    double vehicle_radius = 1.0;
+    double detour_distance = 2.0;
+    double sector_memory_sec = 3.0;
+
+    // Widest valley, in sectors, that is treated as a single opening
+    unsigned int max_valley_sectors = 16;
+
+    // Cost weights: target direction, current heading and previous choice
+    double target_weight = 5.0;
+    double heading_weight = 2.0;
+    double previous_weight = 2.0;
+
+    int heading_to_sector(double heading);
+    double sector_to_heading(int sector);
+    unsigned int sector_diff(int a, int b);
+
+    void update_histogram(const std::vector<Obstacle> &obstacles, double yaw,
+            double max_dist);
+    bool forget_unseen(double yaw, std::chrono::steady_clock::time_point now);
+    void find_candidates(int target_sector);
+    int select_sector(int target_sector, int heading_sector);
+};
@@ -0,0 +1,189 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "avoidance/vff.hh"
+
+// exp(x) = 2^n * exp(r), with n = round(x / ln2) and |r| <= ln2 / 2. ln2 is
+// split in two parts so that r is computed without losing precision, and
+// exp(r) is approximated by a polynomial (Cephes expf).
+namespace exp_approx
+{
+const float min_x = -87.0;
+const float max_x = 88.0;
+const float log2e = 1.44269504088896341;
+const float ln2_hi = 0.693359375;
+const float ln2_lo = -2.12194440e-4;
+const float p0 = 1.9875691500e-4;
+const float p1 = 1.3981999507e-3;
+const float p2 = 8.3334519073e-3;
+const float p3 = 4.1665795894e-2;
+const float p4 = 1.6666665459e-1;
+const float p5 = 5.0000001201e-1;
+}
+
+static inline float exp_ps(float x)
+{
+    using namespace exp_approx;
+
+    x = x < min_x ? min_x : (x > max_x ? max_x : x);
+
+    float fn = nearbyintf(x * log2e);
+    float r = x - fn * ln2_hi - fn * ln2_lo;
+
+    float p = p0;
+    p = p * r + p1;
+    p = p * r + p2;
+    p = p * r + p3;
+    p = p * r + p4;
+    p = p * r + p5;
+    float y = p * r * r + r + 1.0f;
+
+    int32_t bits = ((int32_t) fn + 127) << 23;
+    float scale;
+    memcpy(&scale, &bits, sizeof(scale));
+
+    return y * scale;
+}
+
+#ifdef __SSE2__
+static inline __m128 exp_ps(__m128 x)
+{
+    using namespace exp_approx;
+
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(min_x)), _mm_set1_ps(max_x));
+
+    __m128i n = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(log2e)));
+    __m128 fn = _mm_cvtepi32_ps(n);
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(ln2_hi)));
+    r = _mm_sub_ps(r, _mm_mul_ps(fn, _mm_set1_ps(ln2_lo)));
+
+    __m128 p = _mm_set1_ps(p0);
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(p1));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(p2));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(p3));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(p4));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(p5));
+    __m128 y = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, r), r),
+            _mm_add_ps(r, _mm_set1_ps(1.0f)));
+
+    __m128i bits = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23);
+
+    return _mm_mul_ps(y, _mm_castsi128_ps(bits));
+}
+#endif
+
+void VFFObstacles::assign(const std::vector<Obstacle> &obstacles)
+{
+    this->dist.resize(obstacles.size());
+    this->theta.resize(obstacles.size());
+    this->phi.resize(obstacles.size());
+
+    for (size_t i = 0; i < obstacles.size(); i++) {
+        this->dist[i] = obstacles[i].center.x;
+        this->theta[i] = obstacles[i].center.y;
+        this->phi[i] = obstacles[i].center.z;
+    }
+}
+
+void vff_repulsion(const float *dist, const float *theta, const float *phi,
+        size_t n, const VFFParams &params, float &repulse_x, float &repulse_y)
+{
+    // Per obstacle, with the angles clamped away from zero:
+    //   x: -ko * sign(theta) * sigmoid(s1 * (1 - |phi| / s2)) * exp(-c3 * d - c4 * |theta|)
+    //   y: -ko * sign(phi) * sigmoid(t1 * (1 - |theta| / t2)) * exp(-c3 * d - c4 * |phi|)
+    float sum_x = 0;
+    float sum_y = 0;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 min_theta = _mm_set1_ps(params.min_theta);
+    const __m128 min_phi = _mm_set1_ps(params.min_phi);
+    const __m128 c3 = _mm_set1_ps(-params.c3);
+    const __m128 c4 = _mm_set1_ps(-params.c4);
+    const __m128 s1 = _mm_set1_ps(-params.s1);
+    const __m128 s2 = _mm_set1_ps(1.0f / params.s2);
+    const __m128 t1 = _mm_set1_ps(-params.t1);
+    const __m128 t2 = _mm_set1_ps(1.0f / params.t2);
+    __m128 acc_x = _mm_setzero_ps();
+    __m128 acc_y = _mm_setzero_ps();
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 d = _mm_loadu_ps(dist + i);
+        __m128 th = _mm_loadu_ps(theta + i);
+        __m128 ph = _mm_loadu_ps(phi + i);
+
+        // Clamping keeps the sign, so sign(angle) is +/-1 with its sign bit
+        __m128 sign_th = _mm_or_ps(_mm_and_ps(th, sign_mask), one);
+        __m128 sign_ph = _mm_or_ps(_mm_and_ps(ph, sign_mask), one);
+        __m128 abs_th = _mm_max_ps(_mm_andnot_ps(sign_mask, th), min_theta);
+        __m128 abs_ph = _mm_max_ps(_mm_andnot_ps(sign_mask, ph), min_phi);
+
+        __m128 cd = _mm_mul_ps(c3, d);
+        __m128 ex = exp_ps(_mm_add_ps(cd, _mm_mul_ps(c4, abs_th)));
+        __m128 ey = exp_ps(_mm_add_ps(cd, _mm_mul_ps(c4, abs_ph)));
+
+        __m128 zx = _mm_mul_ps(s1, _mm_sub_ps(one, _mm_mul_ps(abs_ph, s2)));
+        __m128 zy = _mm_mul_ps(t1, _mm_sub_ps(one, _mm_mul_ps(abs_th, t2)));
+        __m128 sx = _mm_div_ps(one, _mm_add_ps(one, exp_ps(zx)));
+        __m128 sy = _mm_div_ps(one, _mm_add_ps(one, exp_ps(zy)));
+
+        acc_x = _mm_add_ps(acc_x, _mm_mul_ps(_mm_mul_ps(sign_th, sx), ex));
+        acc_y = _mm_add_ps(acc_y, _mm_mul_ps(_mm_mul_ps(sign_ph, sy), ey));
+    }
+
+    float lanes_x[4], lanes_y[4];
+    _mm_storeu_ps(lanes_x, acc_x);
+    _mm_storeu_ps(lanes_y, acc_y);
+    sum_x = (lanes_x[0] + lanes_x[1]) + (lanes_x[2] + lanes_x[3]);
+    sum_y = (lanes_y[0] + lanes_y[1]) + (lanes_y[2] + lanes_y[3]);
+#endif
+
+    for (; i < n; i++) {
+        float abs_th = fmaxf(fabsf(theta[i]), params.min_theta);
+        float abs_ph = fmaxf(fabsf(phi[i]), params.min_phi);
+        float sign_th = copysignf(1.0f, theta[i]);
+        float sign_ph = copysignf(1.0f, phi[i]);
+
+        float ex = exp_ps(-params.c3 * dist[i] - params.c4 * abs_th);
+        float ey = exp_ps(-params.c3 * dist[i] - params.c4 * abs_ph);
+        float sx = 1.0f / (1.0f + exp_ps(-params.s1 * (1.0f - abs_ph / params.s2)));
+        float sy = 1.0f / (1.0f + exp_ps(-params.t1 * (1.0f - abs_th / params.t2)));
+
+        sum_x += sign_th * sx * ex;
+        sum_y += sign_ph * sy * ey;
+    }
+
+    repulse_x = -params.ko * sum_x;
+    repulse_y = -params.ko * sum_y;
+}
+
+void vff_repulsion(const VFFObstacles &obstacles, const VFFParams &params,
+        float &repulse_x, float &repulse_y)
+{
+    vff_repulsion(obstacles.dist.data(), obstacles.theta.data(),
+            obstacles.phi.data(), obstacles.size(), params, repulse_x,
+            repulse_y);
+}
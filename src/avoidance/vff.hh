@@ -0,0 +1,65 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "common/common.hh"
+
+/**
+ * Parameters of the obstacle repulsion of the Virtual Force Field.
+ */
+struct VFFParams {
+    float ko = 1.0;
+    float c3 = 1.0;
+    float c4 = 1.0;
+    float s1 = 1.0;
+    float s2 = 1.0;
+    float t1 = 1.0;
+    float t2 = 1.0;
+
+    // Angles closer to zero than this are clamped to -/+ the threshold
+    float min_theta = 0.01;
+    float min_phi = 0.01;
+};
+
+/**
+ * Obstacles laid out as one array per coordinate, so they can be processed
+ * in batches.
+ */
+struct VFFObstacles {
+    std::vector<float> dist;
+    std::vector<float> theta;
+    std::vector<float> phi;
+
+    void assign(const std::vector<Obstacle> &obstacles);
+    size_t size() const { return this->dist.size(); }
+};
+
+/**
+ * @brief Sum of the repulsion rates of a batch of obstacles.
+ *
+ * Exponentials are evaluated with a polynomial approximation whose relative
+ * error is below 1e-6 in the float range, four obstacles at a time when SSE2
+ * is available.
+ */
+void vff_repulsion(const float *dist, const float *theta, const float *phi,
+        size_t n, const VFFParams &params, float &repulse_x, float &repulse_y);
+
+void vff_repulsion(const VFFObstacles &obstacles, const VFFParams &params,
+        float &repulse_x, float &repulse_y);
@@ -0,0 +1,169 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#include "common/latency.hh"
+
+struct Registry {
+    std::mutex mtx;
+    std::vector<LatencyHistogram *> histograms;
+};
+
+// Constructed on first use, so histograms that are static objects in other
+// translation units can register themselves
+static Registry &registry()
+{
+    static Registry r;
+    return r;
+}
+
+LatencyHistogram::LatencyHistogram(const std::string &name)
+    : name(name), count(0), sum_ns(0), max_ns(0)
+{
+    for (std::atomic<uint64_t> &b : this->buckets) {
+        b.store(0, std::memory_order_relaxed);
+    }
+
+    Registry &r = registry();
+    std::lock_guard<std::mutex> locker(r.mtx);
+    r.histograms.push_back(this);
+}
+
+LatencyHistogram::~LatencyHistogram()
+{
+    Registry &r = registry();
+    std::lock_guard<std::mutex> locker(r.mtx);
+    r.histograms.erase(std::remove(r.histograms.begin(), r.histograms.end(),
+                this), r.histograms.end());
+}
+
+const std::string &LatencyHistogram::get_name() const
+{
+    return this->name;
+}
+
+unsigned int LatencyHistogram::bucket_index(uint64_t ns)
+{
+    // Values below SUB_BUCKETS have a bucket each
+    if (ns < SUB_BUCKETS) {
+        return ns;
+    }
+
+    // Otherwise the position of the highest bit selects a group of
+    // SUB_BUCKETS buckets and the next SUB_BITS bits the bucket in it
+    unsigned int exponent = 63 - __builtin_clzll(ns);
+    unsigned int sub = (ns >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1);
+    unsigned int index = (exponent - SUB_BITS + 1) * SUB_BUCKETS + sub;
+
+    return std::min(index, NUM_BUCKETS - 1);
+}
+
+uint64_t LatencyHistogram::bucket_limit(unsigned int index)
+{
+    // Largest value that falls in the bucket
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+
+    unsigned int exponent = index / SUB_BUCKETS + SUB_BITS - 1;
+    uint64_t sub = index % SUB_BUCKETS;
+    uint64_t width = 1ull << (exponent - SUB_BITS);
+
+    return (SUB_BUCKETS + sub + 1) * width - 1;
+}
+
+void LatencyHistogram::record(std::chrono::steady_clock::duration latency)
+{
+    int64_t signed_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+    uint64_t ns = signed_ns > 0 ? signed_ns : 0;
+
+    this->buckets[bucket_index(ns)].fetch_add(1, std::memory_order_relaxed);
+    this->sum_ns.fetch_add(ns, std::memory_order_relaxed);
+    this->count.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t max = this->max_ns.load(std::memory_order_relaxed);
+    while (ns > max && !this->max_ns.compare_exchange_weak(max, ns,
+                std::memory_order_relaxed)) {
+    }
+}
+
+LatencySummary LatencyHistogram::get_summary() const
+{
+    LatencySummary summary;
+
+    // Counts are read one by one while recording goes on, so the total is
+    // taken from the buckets themselves to keep the percentiles consistent
+    uint64_t counts[NUM_BUCKETS];
+    uint64_t total = 0;
+    for (unsigned int i = 0; i < NUM_BUCKETS; i++) {
+        counts[i] = this->buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    if (total == 0) {
+        return summary;
+    }
+
+    summary.count = total;
+    summary.mean = this->sum_ns.load(std::memory_order_relaxed) /
+        (double) this->count.load(std::memory_order_relaxed) / 1e9;
+    summary.max = this->max_ns.load(std::memory_order_relaxed) / 1e9;
+
+    double *percentiles[] = {&summary.p50, &summary.p99, &summary.p999};
+    double ranks[] = {0.5, 0.99, 0.999};
+    uint64_t seen = 0;
+    unsigned int p = 0;
+
+    for (unsigned int i = 0; i < NUM_BUCKETS && p < 3; i++) {
+        seen += counts[i];
+        while (p < 3 && seen >= ranks[p] * total) {
+            *percentiles[p] = std::min(bucket_limit(i) / 1e9, summary.max);
+            p++;
+        }
+    }
+
+    return summary;
+}
+
+std::string latency_report()
+{
+    std::string report;
+    char line[160];
+
+    snprintf(line, sizeof(line), "%-24s %10s %9s %9s %9s %9s %9s\n", "(ms)",
+             "count", "mean", "p50", "p99", "p99.9", "max");
+    report += line;
+
+    Registry &r = registry();
+    std::lock_guard<std::mutex> locker(r.mtx);
+
+    for (const LatencyHistogram *h : r.histograms) {
+        LatencySummary s = h->get_summary();
+        snprintf(line, sizeof(line),
+                 "%-24s %10llu %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+                 h->get_name().c_str(), (unsigned long long) s.count,
+                 s.mean * 1e3, s.p50 * 1e3, s.p99 * 1e3, s.p999 * 1e3,
+                 s.max * 1e3);
+        report += line;
+    }
+
+    return report;
+}
@@ -0,0 +1,101 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+struct LatencySummary {
+    uint64_t count = 0;
+    // In seconds
+    double mean = 0;
+    double p50 = 0;
+    double p99 = 0;
+    double p999 = 0;
+    double max = 0;
+};
+
+/**
+ * Lock free latency histogram with HDR style log-linear buckets.
+ *
+ * Every power of two of nanoseconds is split in 16 buckets, so percentiles
+ * are within about 6% of the actual value, from nanoseconds up to minutes,
+ * with a fixed amount of memory. Recording is a few relaxed atomic
+ * operations and can be done from any thread while others read.
+ *
+ * Histograms register themselves by name on construction, so they can be
+ * listed by latency_report(). Names are expected to be unique.
+ */
+class LatencyHistogram
+{
+public:
+    LatencyHistogram(const std::string &name);
+    ~LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram &) = delete;
+    LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+    void record(std::chrono::steady_clock::duration latency);
+
+    LatencySummary get_summary() const;
+    const std::string &get_name() const;
+
+private:
+    static const unsigned int SUB_BITS = 4;
+    static const unsigned int SUB_BUCKETS = 1 << SUB_BITS;
+    // Up to 2^40 ns, about 18 minutes; longer latencies go to the last bucket
+    static const unsigned int NUM_BUCKETS = (40 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    static unsigned int bucket_index(uint64_t ns);
+    static uint64_t bucket_limit(unsigned int index);
+
+    std::string name;
+    std::atomic<uint64_t> buckets[NUM_BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum_ns;
+    std::atomic<uint64_t> max_ns;
+};
+
+/**
+ * Records the time from its construction to its destruction.
+ */
+class ScopedLatency
+{
+public:
+    ScopedLatency(LatencyHistogram &histogram)
+        : histogram(histogram), start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~ScopedLatency()
+    {
+        this->histogram.record(std::chrono::steady_clock::now() - this->start);
+    }
+
+private:
+    LatencyHistogram &histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * @brief Table with the summary of every registered histogram, one line
+ * each. Only takes a lock shared with histogram creation, never with
+ * recording.
+ */
+std::string latency_report();
@@ -0,0 +1,150 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/**
+ * Single producer, single consumer slot that only keeps the latest value.
+ *
+ * Implemented as a triple buffer: the producer fills the back buffer and
+ * swaps it with the middle one, the consumer swaps the middle buffer with
+ * the front one when it holds a newer value. Neither side ever waits for
+ * the other; a value the consumer did not get to in time is overwritten
+ * by the next one. The consumer can block on an eventfd until a value is
+ * published.
+ */
+template <typename T>
+class LatestSlot
+{
+public:
+    LatestSlot()
+    {
+        this->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+
+    ~LatestSlot()
+    {
+        close(this->event_fd);
+    }
+
+    LatestSlot(const LatestSlot &) = delete;
+    LatestSlot &operator=(const LatestSlot &) = delete;
+
+    /**
+     * @brief Buffer the producer fills before calling publish().
+     */
+    T &back()
+    {
+        return this->buffers[this->back_index];
+    }
+
+    /**
+     * @brief Make the back buffer visible to the consumer.
+     *
+     * @return false if a value the consumer had not taken was overwritten.
+     */
+    bool publish()
+    {
+        uint8_t previous = this->middle.exchange(this->back_index | FRESH,
+                std::memory_order_acq_rel);
+        this->back_index = previous & INDEX;
+
+        // Only fails if the counter overflows, which a reader never lets
+        // happen
+        uint64_t one = 1;
+        ssize_t ret = write(this->event_fd, &one, sizeof(one));
+        (void) ret;
+
+        return !(previous & FRESH);
+    }
+
+    /**
+     * @brief Move the latest published value, if there is a new one, to
+     * the front buffer.
+     *
+     * @return Whether front() changed.
+     */
+    bool update()
+    {
+        if (!(this->middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+
+        uint8_t previous = this->middle.exchange(this->front_index,
+                std::memory_order_acq_rel);
+        this->front_index = previous & INDEX;
+
+        return true;
+    }
+
+    /**
+     * @brief Like update(), but wait up to 'timeout' for a new value.
+     */
+    bool wait(std::chrono::steady_clock::duration timeout)
+    {
+        using namespace std::chrono;
+
+        steady_clock::time_point deadline = steady_clock::now() + timeout;
+
+        while (!this->update()) {
+            steady_clock::duration left = deadline - steady_clock::now();
+            if (left <= steady_clock::duration::zero()) {
+                return false;
+            }
+
+            struct pollfd pfd = {this->event_fd, POLLIN, 0};
+            int ms = (int) duration_cast<milliseconds>(left).count() + 1;
+            if (poll(&pfd, 1, ms) > 0) {
+                // Clear the counter, update() tells if there is a new value
+                uint64_t count;
+                ssize_t ret = read(this->event_fd, &count, sizeof(count));
+                (void) ret;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Buffer holding the value taken by the last update().
+     */
+    T &front()
+    {
+        return this->buffers[this->front_index];
+    }
+
+private:
+    static const uint8_t INDEX = 0x3;
+    static const uint8_t FRESH = 0x4;
+
+    T buffers[3];
+
+    // Index of the middle buffer, plus FRESH if the consumer has not seen it
+    std::atomic<uint8_t> middle{1};
+
+    // Only used by the producer and the consumer respectively
+    uint8_t back_index = 2;
+    uint8_t front_index = 0;
+
+    int event_fd = -1;
+};
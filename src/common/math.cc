@@ -38,3 +38,11 @@ PolarVector cartesian_to_spherical(double x, double y, double z)
 
     return p;
 }
+
+glm::dvec3 rotate_z(const glm::dvec3 &v, double angle)
+{
+    double c = cos(angle);
+    double s = sin(angle);
+
+    return glm::dvec3(v.x * c - v.y * s, v.x * s + v.y * c, v.z);
+}
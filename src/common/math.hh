@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <glm/glm.hpp>
+
 #define inbounds(X, A, B) ((X) >= A && (X) <= B)
 
 int sign(double x);
@@ -32,3 +34,8 @@ struct PolarVector {
 };
 
 PolarVector cartesian_to_spherical(double x, double y, double z);
+
+/**
+ * @brief Rotate a vector around the z axis, counterclockwise.
+ */
+glm::dvec3 rotate_z(const glm::dvec3 &v, double angle);
@@ -0,0 +1,177 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <cmath>
+
+#include "common/obstacles.hh"
+
+ObstacleSetTracker::ObstacleSetTracker(double range_tolerance,
+        double angle_tolerance)
+{
+    this->range_tolerance = range_tolerance;
+    this->angle_tolerance = angle_tolerance;
+}
+
+uint64_t ObstacleSetTracker::get_fingerprint()
+{
+    return this->fingerprint;
+}
+
+const ObstacleDelta &ObstacleSetTracker::get_delta()
+{
+    return this->delta;
+}
+
+void ObstacleSetTracker::reset()
+{
+    this->has_reference = false;
+    this->reference.clear();
+}
+
+static inline uint64_t mix(uint64_t x)
+{
+    // splitmix64 finalizer
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t ObstacleSetTracker::compute_fingerprint(
+        const std::vector<Obstacle> &obstacles)
+{
+    // Positions are quantized to the tolerances and the hashes are added up,
+    // so the fingerprint does not depend on the order of the obstacles
+    uint64_t sum = mix(obstacles.size());
+
+    for (const Obstacle &o : obstacles) {
+        uint64_t r = (uint64_t) (int64_t) floor(o.center.x / this->range_tolerance);
+        uint64_t theta = (uint64_t) (int64_t) floor(o.center.y / this->angle_tolerance);
+        uint64_t phi = (uint64_t) (int64_t) floor(o.center.z / this->angle_tolerance);
+
+        sum += mix(r ^ mix(theta ^ mix(phi)));
+    }
+
+    return sum;
+}
+
+bool ObstacleSetTracker::is_close(const Obstacle &a, const Obstacle &b)
+{
+    return fabs(a.center.x - b.center.x) <= this->range_tolerance &&
+        fabs(a.center.y - b.center.y) <= this->angle_tolerance &&
+        fabs(a.center.z - b.center.z) <= this->angle_tolerance;
+}
+
+void ObstacleSetTracker::compute_delta(const std::vector<Obstacle> &obstacles)
+{
+    this->delta.added.clear();
+    this->delta.removed.clear();
+    this->delta.moved.clear();
+
+    if (!this->has_reference) {
+        for (size_t i = 0; i < obstacles.size(); i++) {
+            this->delta.added.push_back(i);
+        }
+        return;
+    }
+
+    size_t n = this->reference.size();
+    this->matched.assign(n, false);
+    std::vector<bool> current_matched(obstacles.size(), false);
+
+    // Same id and close enough
+    for (size_t i = 0; i < obstacles.size(); i++) {
+        for (size_t k = 0; k < n; k++) {
+            if (!this->matched[k] && this->reference[k].id == obstacles[i].id &&
+                    this->is_close(this->reference[k], obstacles[i])) {
+                this->matched[k] = true;
+                current_matched[i] = true;
+                break;
+            }
+        }
+    }
+
+    // Close enough, whatever the id
+    for (size_t i = 0; i < obstacles.size(); i++) {
+        if (current_matched[i]) {
+            continue;
+        }
+
+        for (size_t k = 0; k < n; k++) {
+            if (!this->matched[k] &&
+                    this->is_close(this->reference[k], obstacles[i])) {
+                this->matched[k] = true;
+                current_matched[i] = true;
+                break;
+            }
+        }
+    }
+
+    // Whatever is left either kept its id and moved, or is new
+    for (size_t i = 0; i < obstacles.size(); i++) {
+        if (current_matched[i]) {
+            continue;
+        }
+
+        bool moved = false;
+        for (size_t k = 0; k < n; k++) {
+            if (!this->matched[k] && this->reference[k].id == obstacles[i].id) {
+                this->matched[k] = true;
+                moved = true;
+                break;
+            }
+        }
+
+        if (moved) {
+            this->delta.moved.push_back(i);
+        } else {
+            this->delta.added.push_back(i);
+        }
+    }
+
+    for (size_t k = 0; k < n; k++) {
+        if (!this->matched[k]) {
+            this->delta.removed.push_back(k);
+        }
+    }
+}
+
+bool ObstacleSetTracker::update(const std::vector<Obstacle> &obstacles)
+{
+    uint64_t fingerprint = this->compute_fingerprint(obstacles);
+
+    // Same quantized positions, every obstacle is within the tolerances
+    if (this->has_reference && fingerprint == this->fingerprint) {
+        this->delta.added.clear();
+        this->delta.removed.clear();
+        this->delta.moved.clear();
+        return false;
+    }
+
+    this->compute_delta(obstacles);
+
+    if (this->has_reference && this->delta.empty()) {
+        return false;
+    }
+
+    this->reference = obstacles;
+    this->fingerprint = fingerprint;
+    this->has_reference = true;
+
+    return true;
+}
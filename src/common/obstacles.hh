@@ -0,0 +1,88 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common/common.hh"
+
+/**
+ * Changes between two obstacle sets. Added and moved are indices into the
+ * current set, removed are indices into the reference set.
+ */
+struct ObstacleDelta {
+    std::vector<size_t> added;
+    std::vector<size_t> removed;
+    std::vector<size_t> moved;
+
+    bool empty() const
+    {
+        return added.empty() && removed.empty() && moved.empty();
+    }
+};
+
+/**
+ * Tells whether consecutive detections changed enough to be worth acting on.
+ *
+ * Each update is compared against a reference set, the last one that was
+ * reported as changed, so slow drifts still add up to a change. Obstacles
+ * are matched first by id and then by position, as not every detector keeps
+ * ids stable between frames. An obstacle that moved less than the tolerances
+ * in range and in both angles is considered unchanged.
+ *
+ * A fingerprint of the quantized positions is checked first, so repeated
+ * detections are recognized without matching.
+ */
+class ObstacleSetTracker
+{
+public:
+    ObstacleSetTracker(double range_tolerance = 0.1,
+            double angle_tolerance = 0.02);
+
+    /**
+     * @brief Compare obstacles with the reference set.
+     *
+     * @return true if the set changed, in which case it becomes the new
+     * reference.
+     */
+    bool update(const std::vector<Obstacle> &obstacles);
+
+    /**
+     * @brief Forget the reference set, the next update reports a change.
+     */
+    void reset();
+
+    uint64_t get_fingerprint();
+    const ObstacleDelta &get_delta();
+
+private:
+    std::vector<Obstacle> reference;
+    std::vector<bool> matched;
+    ObstacleDelta delta;
+
+    uint64_t fingerprint = 0;
+    bool has_reference = false;
+
+    double range_tolerance;
+    double angle_tolerance;
+
+    uint64_t compute_fingerprint(const std::vector<Obstacle> &obstacles);
+    bool is_close(const Obstacle &a, const Obstacle &b);
+    void compute_delta(const std::vector<Obstacle> &obstacles);
+};
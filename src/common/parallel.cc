@@ -0,0 +1,110 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "common/parallel.hh"
+#include "common/thread_pool.hh"
+
+// Chunks of one call, shared with the pool tasks helping with it. Tasks may
+// start after the call returned, so this outlives the caller's stack.
+struct ParallelJob {
+    std::function<void(size_t, size_t)> func;
+    size_t count;
+    size_t chunk;
+    size_t num_chunks;
+
+    std::atomic<size_t> next;
+    size_t done = 0;
+    std::mutex mtx;
+    std::condition_variable cv;
+
+    // Run chunks until none is left
+    void work()
+    {
+        size_t finished = 0;
+
+        for (size_t c = this->next++; c < this->num_chunks; c = this->next++) {
+            size_t begin = c * this->chunk;
+            this->func(begin, std::min(begin + this->chunk, this->count));
+            finished++;
+        }
+
+        if (finished) {
+            std::lock_guard<std::mutex> locker(this->mtx);
+            this->done += finished;
+            if (this->done == this->num_chunks) {
+                this->cv.notify_one();
+            }
+        }
+    }
+};
+
+// Created on first use and shared by every call, so no thread is started
+// per frame. The calling thread is one of the workers of each call, hence
+// one thread less than the number of cores.
+static ThreadPool &helper_pool()
+{
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency() - 1));
+    return pool;
+}
+
+void parallel_for(size_t count,
+        const std::function<void(size_t begin, size_t end)> &func,
+        unsigned int max_threads)
+{
+    size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (max_threads) {
+        num_threads = std::min(num_threads, (size_t) max_threads);
+    }
+    num_threads = std::min(num_threads, count);
+
+    if (ThreadPool::in_worker()) {
+        num_threads = 1;
+    }
+
+    if (num_threads <= 1) {
+        if (count) {
+            func(0, count);
+        }
+        return;
+    }
+
+    std::shared_ptr<ParallelJob> job = std::make_shared<ParallelJob>();
+    job->func = func;
+    job->count = count;
+    job->chunk = (count + num_threads - 1) / num_threads;
+    job->num_chunks = (count + job->chunk - 1) / job->chunk;
+    job->next = 0;
+
+    ThreadPool &pool = helper_pool();
+    for (size_t i = 1; i < job->num_chunks; i++) {
+        pool.submit([job]() { job->work(); });
+    }
+
+    // Chunks are claimed from a shared counter and the calling thread takes
+    // part, so the call completes even when the pool is slow to pick up the
+    // tasks; it only waits for chunks already running elsewhere
+    job->work();
+
+    std::unique_lock<std::mutex> locker(job->mtx);
+    job->cv.wait(locker, [&job]() { return job->done == job->num_chunks; });
+}
@@ -0,0 +1,36 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+/**
+ * @brief Split [0, count) in contiguous chunks and run func(begin, end) on
+ * each of them in parallel. Returns when all chunks are done. The calling
+ * thread runs chunks too, helped by a thread pool shared by all calls.
+ *
+ * When called from a ThreadPool worker, the chunks run on the calling thread
+ * instead: the pool already keeps every core busy, and more threads would
+ * only compete with it.
+ *
+ * @param max_threads Upper bound on the number of threads, 0 means one per
+ * available core.
+ */
+void parallel_for(size_t count,
+        const std::function<void(size_t begin, size_t end)> &func,
+        unsigned int max_threads = 0);
@@ -0,0 +1,89 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <glm/gtc/quaternion.hpp>
+
+#include "common/pose_history.hh"
+
+PoseHistory::PoseHistory(size_t capacity)
+{
+    this->samples.resize(capacity ? capacity : 1);
+}
+
+PoseHistory::Sample &PoseHistory::at(size_t i)
+{
+    return this->samples[(this->first + i) % this->samples.size()];
+}
+
+size_t PoseHistory::size()
+{
+    return this->count;
+}
+
+void PoseHistory::clear()
+{
+    this->first = 0;
+    this->count = 0;
+}
+
+void PoseHistory::push(std::chrono::steady_clock::time_point time,
+        const Pose &pose)
+{
+    if (this->count == this->samples.size()) {
+        this->first = (this->first + 1) % this->samples.size();
+        this->count--;
+    }
+
+    Sample &s = this->at(this->count);
+    s.time = time;
+    s.pose = pose;
+    this->count++;
+}
+
+bool PoseHistory::lookup(std::chrono::steady_clock::time_point time,
+        Pose &pose)
+{
+    if (!this->count || time < this->at(0).time) {
+        return false;
+    }
+
+    if (time >= this->at(this->count - 1).time) {
+        pose = this->at(this->count - 1).pose;
+        return true;
+    }
+
+    // First sample newer than 'time', there is always one at this point
+    size_t lo = 1;
+    size_t hi = this->count - 1;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (this->at(mid).time > time) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    const Sample &a = this->at(lo - 1);
+    const Sample &b = this->at(lo);
+    double t = std::chrono::duration<double>(time - a.time).count() /
+        std::chrono::duration<double>(b.time - a.time).count();
+
+    pose.pos = glm::mix(a.pose.pos, b.pose.pos, t);
+    pose.rot = glm::slerp(a.pose.rot, b.pose.rot, t);
+
+    return true;
+}
@@ -0,0 +1,63 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+#include "common/common.hh"
+
+/**
+ * Fixed size ring of timestamped poses, oldest overwritten first.
+ *
+ * Poses must be pushed in time order. Lookups binary search the ring and
+ * interpolate between the two closest samples: linearly for the position
+ * and with SLERP for the rotation.
+ */
+class PoseHistory
+{
+public:
+    PoseHistory(size_t capacity = 256);
+
+    void push(std::chrono::steady_clock::time_point time, const Pose &pose);
+    void clear();
+    size_t size();
+
+    /**
+     * @brief Pose at the given time.
+     *
+     * Times after the newest sample get the newest pose.
+     *
+     * @return false if the history is empty or the time is older than the
+     * oldest sample.
+     */
+    bool lookup(std::chrono::steady_clock::time_point time, Pose &pose);
+
+private:
+    struct Sample {
+        std::chrono::steady_clock::time_point time;
+        Pose pose;
+    };
+
+    std::vector<Sample> samples;
+    // Index of the oldest sample and number of samples
+    size_t first = 0;
+    size_t count = 0;
+
+    Sample &at(size_t i);
+};
@@ -0,0 +1,79 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <alloca.h>
+#include <cstdio>
+#include <cstring>
+#include <malloc.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include "common/realtime.hh"
+
+bool realtime_pin_thread(pthread_t thread, unsigned int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    int err = pthread_setaffinity_np(thread, sizeof(set), &set);
+    if (err) {
+        fprintf(stderr, "[realtime] error pinning thread to CPU %u: %s\n",
+                cpu, strerror(err));
+        return false;
+    }
+
+    return true;
+}
+
+bool realtime_set_priority(pthread_t thread, int priority)
+{
+    struct sched_param param = {};
+    param.sched_priority = priority;
+
+    int err = pthread_setschedparam(thread, SCHED_FIFO, &param);
+    if (err) {
+        fprintf(stderr, "[realtime] error setting SCHED_FIFO priority %d: %s\n",
+                priority, strerror(err));
+        return false;
+    }
+
+    return true;
+}
+
+bool realtime_lock_memory()
+{
+    // Large blocks, such as depth frames, would otherwise be mmapped and
+    // unmapped on every allocation and fault in again each time
+    mallopt(M_MMAP_MAX, 0);
+    mallopt(M_TRIM_THRESHOLD, -1);
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+        perror("[realtime] error locking memory");
+        return false;
+    }
+
+    return true;
+}
+
+void realtime_prefault_stack(size_t size)
+{
+    volatile unsigned char *stack = (volatile unsigned char *) alloca(size);
+
+    for (size_t i = 0; i < size; i += 4096) {
+        stack[i] = 0;
+    }
+}
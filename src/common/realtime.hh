@@ -0,0 +1,49 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <pthread.h>
+
+/**
+ * Helpers to run the collision avoidance loop with a real-time profile.
+ * They need CAP_SYS_NICE and CAP_IPC_LOCK (or root); on failure the error
+ * is printed and false is returned, so callers can carry on without them.
+ */
+
+/**
+ * @brief Restrict a thread to a single CPU.
+ */
+bool realtime_pin_thread(pthread_t thread, unsigned int cpu);
+
+/**
+ * @brief Schedule a thread with SCHED_FIFO at the given priority (1-99).
+ */
+bool realtime_set_priority(pthread_t thread, int priority);
+
+/**
+ * @brief Lock current and future memory of the process in RAM and keep
+ * freed heap memory mapped, so buffers that are allocated again for every
+ * frame reuse pages that are already faulted in.
+ */
+bool realtime_lock_memory();
+
+/**
+ * @brief Touch 'size' bytes of the calling thread's stack, so its pages
+ * are faulted in before they are needed.
+ */
+void realtime_prefault_stack(size_t size = 256 * 1024);
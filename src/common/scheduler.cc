@@ -0,0 +1,88 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <algorithm>
+#include <thread>
+
+#include "common/scheduler.hh"
+
+using namespace std::chrono;
+
+DeadlineScheduler::DeadlineScheduler(steady_clock::duration period)
+{
+    this->period = period;
+    this->deadline = steady_clock::now();
+}
+
+steady_clock::duration DeadlineScheduler::get_period()
+{
+    return this->period;
+}
+
+void DeadlineScheduler::set_period(steady_clock::duration period)
+{
+    this->period = period;
+}
+
+steady_clock::time_point DeadlineScheduler::get_deadline()
+{
+    return this->deadline;
+}
+
+const SchedulerStats &DeadlineScheduler::get_stats()
+{
+    return this->stats;
+}
+
+bool DeadlineScheduler::due(steady_clock::time_point now)
+{
+    if (now < this->deadline) {
+        return false;
+    }
+
+    this->stats.runs++;
+
+    if (this->period <= steady_clock::duration::zero()) {
+        this->deadline = now;
+        return true;
+    }
+
+    steady_clock::duration late = now - this->deadline;
+    double jitter = duration<double>(late).count();
+
+    this->stats.max_jitter = std::max(this->stats.max_jitter, jitter);
+    this->stats.mean_jitter +=
+        (jitter - this->stats.mean_jitter) / this->stats.runs;
+
+    // Skip the periods that were missed while keeping the phase
+    int64_t missed = late / this->period;
+    if (missed) {
+        this->stats.overruns++;
+        this->stats.skipped += missed;
+    }
+
+    this->deadline += (missed + 1) * this->period;
+
+    return true;
+}
+
+void DeadlineScheduler::wait()
+{
+    // sleep_until() may return early on spurious wakeups
+    while (!this->due()) {
+        std::this_thread::sleep_until(this->deadline);
+    }
+}
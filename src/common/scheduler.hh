@@ -0,0 +1,70 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+struct SchedulerStats {
+    // Deadlines that fired
+    uint64_t runs = 0;
+    // Deadlines that fired more than one period late
+    uint64_t overruns = 0;
+    // Periods dropped because of overruns
+    uint64_t skipped = 0;
+    // Delay between a deadline and the run it fired, in seconds
+    double max_jitter = 0;
+    double mean_jitter = 0;
+};
+
+/**
+ * Periodic deadline on the monotonic clock.
+ *
+ * Deadlines are kept phase aligned: when a run is late, the next deadline is
+ * still a whole number of periods from the first one, and periods that were
+ * missed altogether are dropped instead of fired back to back.
+ */
+class DeadlineScheduler
+{
+public:
+    DeadlineScheduler(std::chrono::steady_clock::duration period);
+
+    std::chrono::steady_clock::duration get_period();
+    void set_period(std::chrono::steady_clock::duration period);
+
+    /**
+     * @brief Check whether the deadline has passed. If so, the run is
+     * accounted and the deadline moves to the next period.
+     *
+     * A zero period is always due.
+     */
+    bool due(std::chrono::steady_clock::time_point now =
+            std::chrono::steady_clock::now());
+
+    /**
+     * @brief Sleep until the deadline and account the run.
+     */
+    void wait();
+
+    std::chrono::steady_clock::time_point get_deadline();
+    const SchedulerStats &get_stats();
+
+private:
+    std::chrono::steady_clock::duration period;
+    std::chrono::steady_clock::time_point deadline;
+    SchedulerStats stats;
+};
@@ -0,0 +1,73 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+
+/**
+ * Single writer, multiple reader sequence lock.
+ *
+ * The writer never waits. Readers copy the value and retry if a write
+ * happened meanwhile, so they always get a consistent copy without taking a
+ * lock. T should be plain data that is cheap to copy.
+ */
+template <typename T>
+class SeqLock
+{
+public:
+    SeqLock() : value() {}
+
+    void store(const T &value)
+    {
+        unsigned int seq = this->seq.load(std::memory_order_relaxed);
+
+        // An odd sequence tells readers a write is in progress
+        this->seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        this->value = value;
+
+        this->seq.store(seq + 2, std::memory_order_release);
+    }
+
+    T load() const
+    {
+        T copy;
+        unsigned int before, after;
+
+        do {
+            before = this->seq.load(std::memory_order_acquire);
+            copy = this->value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = this->seq.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+
+        return copy;
+    }
+
+    /**
+     * @brief Number of writes so far.
+     */
+    unsigned int get_version() const
+    {
+        return this->seq.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    std::atomic<unsigned int> seq{0};
+    T value;
+};
@@ -0,0 +1,296 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <cfloat>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+
+#include "common/simd.hh"
+
+// Subtracting one with wrap-around maps 0 to UINT16_MAX and valid depths to
+// [0, UINT16_MAX - 1], so an unsigned minimum skips invalid values without
+// branches. Adding one back restores the depth, or 0 if nothing was valid.
+
+#if defined(__SSE2__)
+static inline __m128i min_epu16(__m128i a, __m128i b)
+{
+#if defined(__SSE4_1__)
+    return _mm_min_epu16(a, b);
+#else
+    // SSE2 only has a signed minimum, flip the sign bit to keep the order
+    const __m128i bias = _mm_set1_epi16((short) 0x8000);
+    return _mm_xor_si128(
+        _mm_min_epi16(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias)), bias);
+#endif
+}
+#endif
+
+uint16_t depth_min(const uint16_t *depth, size_t n)
+{
+    uint16_t min = UINT16_MAX;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i one = _mm_set1_epi16(1);
+    __m128i vmin = _mm_set1_epi16((short) UINT16_MAX);
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (depth + i));
+        vmin = min_epu16(vmin, _mm_sub_epi16(v, one));
+    }
+
+    uint16_t lanes[8];
+    _mm_storeu_si128((__m128i *) lanes, vmin);
+    for (int k = 0; k < 8; k++) {
+        min = lanes[k] < min ? lanes[k] : min;
+    }
+#endif
+
+    for (; i < n; i++) {
+        uint16_t d = depth[i] - 1;
+        min = d < min ? d : min;
+    }
+
+    return min + 1;
+}
+
+void depth_min_accumulate(uint16_t *acc, const uint16_t *depth, size_t n)
+{
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i one = _mm_set1_epi16(1);
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *) (acc + i));
+        __m128i v = _mm_loadu_si128((const __m128i *) (depth + i));
+        __m128i m = min_epu16(_mm_sub_epi16(a, one), _mm_sub_epi16(v, one));
+        _mm_storeu_si128((__m128i *) (acc + i), _mm_add_epi16(m, one));
+    }
+#endif
+
+    for (; i < n; i++) {
+        uint16_t a = acc[i] - 1;
+        uint16_t d = depth[i] - 1;
+        acc[i] = (d < a ? d : a) + 1;
+    }
+}
+
+size_t depth_count_below(const uint16_t *depth, size_t n, uint16_t limit)
+{
+    size_t count = 0;
+    size_t i = 0;
+
+    if (limit == 0) {
+        return 0;
+    }
+
+#if defined(__SSE2__)
+    // Compare d - 1 < limit with a signed compare on sign flipped values.
+    // Matching lanes are -1, so subtracting the mask counts them. Counters
+    // are 16 bits wide and must be flushed before they can overflow.
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i bias = _mm_set1_epi16((short) 0x8000);
+    const __m128i vlimit = _mm_xor_si128(_mm_set1_epi16((short) limit), bias);
+
+    while (i + 8 <= n) {
+        __m128i vcount = _mm_setzero_si128();
+        size_t end = i + 8 * (size_t) INT16_MAX;
+        end = end < n ? end : n;
+
+        for (; i + 8 <= end; i += 8) {
+            __m128i v = _mm_loadu_si128((const __m128i *) (depth + i));
+            v = _mm_xor_si128(_mm_sub_epi16(v, one), bias);
+            vcount = _mm_sub_epi16(vcount, _mm_cmplt_epi16(v, vlimit));
+        }
+
+        uint16_t lanes[8];
+        _mm_storeu_si128((__m128i *) lanes, vcount);
+        for (int k = 0; k < 8; k++) {
+            count += lanes[k];
+        }
+    }
+#endif
+
+    for (; i < n; i++) {
+        uint16_t d = depth[i] - 1;
+        count += d < limit;
+    }
+
+    return count;
+}
+
+size_t depth_count_below_each(const uint16_t *depth, const uint16_t *limits,
+        size_t n)
+{
+    size_t count = 0;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    // Same as depth_count_below(), with a limit loaded per lane
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i bias = _mm_set1_epi16((short) 0x8000);
+
+    while (i + 8 <= n) {
+        __m128i vcount = _mm_setzero_si128();
+        size_t end = i + 8 * (size_t) INT16_MAX;
+        end = end < n ? end : n;
+
+        for (; i + 8 <= end; i += 8) {
+            __m128i v = _mm_loadu_si128((const __m128i *) (depth + i));
+            __m128i l = _mm_loadu_si128((const __m128i *) (limits + i));
+            v = _mm_xor_si128(_mm_sub_epi16(v, one), bias);
+            l = _mm_xor_si128(l, bias);
+            vcount = _mm_sub_epi16(vcount, _mm_cmplt_epi16(v, l));
+        }
+
+        uint16_t lanes[8];
+        _mm_storeu_si128((__m128i *) lanes, vcount);
+        for (int k = 0; k < 8; k++) {
+            count += lanes[k];
+        }
+    }
+#endif
+
+    for (; i < n; i++) {
+        uint16_t d = depth[i] - 1;
+        count += d < limits[i];
+    }
+
+    return count;
+}
+
+uint16_t depth_min_below_each(const uint16_t *depth, const uint16_t *limits,
+        size_t n)
+{
+    uint16_t min = UINT16_MAX;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    // Lanes above their limit are replaced by UINT16_MAX, the same value an
+    // invalid depth takes, before the minimum
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i bias = _mm_set1_epi16((short) 0x8000);
+    const __m128i none = _mm_set1_epi16((short) UINT16_MAX);
+    __m128i vmin = none;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_sub_epi16(
+                _mm_loadu_si128((const __m128i *) (depth + i)), one);
+        __m128i l = _mm_loadu_si128((const __m128i *) (limits + i));
+        __m128i below = _mm_cmplt_epi16(_mm_xor_si128(v, bias),
+                _mm_xor_si128(l, bias));
+        v = _mm_or_si128(_mm_and_si128(below, v), _mm_andnot_si128(below, none));
+        vmin = min_epu16(vmin, v);
+    }
+
+    uint16_t lanes[8];
+    _mm_storeu_si128((__m128i *) lanes, vmin);
+    for (int k = 0; k < 8; k++) {
+        min = lanes[k] < min ? lanes[k] : min;
+    }
+#endif
+
+    for (; i < n; i++) {
+        uint16_t d = depth[i] - 1;
+        d = d < limits[i] ? d : UINT16_MAX;
+        min = d < min ? d : min;
+    }
+
+    return min + 1;
+}
+
+float min_dist2(const float *x, const float *y, size_t n, float px, float py)
+{
+    float min = FLT_MAX;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128 vpx = _mm_set1_ps(px);
+    const __m128 vpy = _mm_set1_ps(py);
+    __m128 vmin = _mm_set1_ps(FLT_MAX);
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), vpx);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), vpy);
+        __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        vmin = _mm_min_ps(vmin, d2);
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, vmin);
+    for (int k = 0; k < 4; k++) {
+        min = lanes[k] < min ? lanes[k] : min;
+    }
+#endif
+
+    for (; i < n; i++) {
+        float dx = x[i] - px;
+        float dy = y[i] - py;
+        float d2 = dx * dx + dy * dy;
+        min = d2 < min ? d2 : min;
+    }
+
+    return min;
+}
+
+void transform_points(float *x, float *y, float *z, size_t n, const float m[9],
+        const float t[3])
+{
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    __m128 vm[9];
+    for (int k = 0; k < 9; k++) {
+        vm[k] = _mm_set1_ps(m[k]);
+    }
+    const __m128 tx = _mm_set1_ps(t[0]);
+    const __m128 ty = _mm_set1_ps(t[1]);
+    const __m128 tz = _mm_set1_ps(t[2]);
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 px = _mm_loadu_ps(x + i);
+        __m128 py = _mm_loadu_ps(y + i);
+        __m128 pz = _mm_loadu_ps(z + i);
+
+        __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vm[0], px),
+                    _mm_mul_ps(vm[1], py)), _mm_add_ps(_mm_mul_ps(vm[2], pz), tx));
+        __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vm[3], px),
+                    _mm_mul_ps(vm[4], py)), _mm_add_ps(_mm_mul_ps(vm[5], pz), ty));
+        __m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vm[6], px),
+                    _mm_mul_ps(vm[7], py)), _mm_add_ps(_mm_mul_ps(vm[8], pz), tz));
+
+        _mm_storeu_ps(x + i, rx);
+        _mm_storeu_ps(y + i, ry);
+        _mm_storeu_ps(z + i, rz);
+    }
+#endif
+
+    for (; i < n; i++) {
+        float px = x[i];
+        float py = y[i];
+        float pz = z[i];
+
+        x[i] = m[0] * px + m[1] * py + m[2] * pz + t[0];
+        y[i] = m[3] * px + m[4] * py + m[5] * pz + t[1];
+        z[i] = m[6] * px + m[7] * py + m[8] * pz + t[2];
+    }
+}
@@ -0,0 +1,67 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Depth buffer kernels. Depth 0 means "no reading" and is ignored, as if it
+// was farther than any valid depth.
+
+/**
+ * @brief Minimum valid depth of a buffer, 0 if there is none.
+ */
+uint16_t depth_min(const uint16_t *depth, size_t n);
+
+/**
+ * @brief Element-wise minimum valid depth: acc[i] = min(acc[i], depth[i]).
+ */
+void depth_min_accumulate(uint16_t *acc, const uint16_t *depth, size_t n);
+
+/**
+ * @brief Number of valid depths that are lower than or equal to 'limit'.
+ */
+size_t depth_count_below(const uint16_t *depth, size_t n, uint16_t limit);
+
+/**
+ * @brief Number of valid depths that are lower than or equal to the limit
+ * at the same position: depth[i] <= limits[i].
+ */
+size_t depth_count_below_each(const uint16_t *depth, const uint16_t *limits,
+        size_t n);
+
+/**
+ * @brief Minimum valid depth among those lower than or equal to the limit at
+ * the same position, 0 if there is none.
+ */
+uint16_t depth_min_below_each(const uint16_t *depth, const uint16_t *limits,
+        size_t n);
+
+// Point set kernels. Points are given as separate x and y arrays.
+
+/**
+ * @brief Squared distance from (px, py) to the closest of n points, FLT_MAX
+ * if there are none.
+ */
+float min_dist2(const float *x, const float *y, size_t n, float px, float py);
+
+/**
+ * @brief Rigid transform of n points, in place: p = m * p + t, with m a row
+ * major 3x3 matrix. Points are given as separate x, y and z arrays.
+ */
+void transform_points(float *x, float *y, float *z, size_t n, const float m[9],
+        const float t[3]);
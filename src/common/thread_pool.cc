@@ -0,0 +1,149 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <algorithm>
+
+#include "common/thread_pool.hh"
+
+// Pool and queue of the worker running on this thread, if any
+static thread_local ThreadPool *worker_pool = nullptr;
+static thread_local unsigned int worker_index = 0;
+
+ThreadPool::ThreadPool(unsigned int num_threads)
+    : pending(0), running(true), next_queue(0), executed(0), stolen(0)
+{
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned int i = 0; i < num_threads; i++) {
+        this->queues.emplace_back(new Queue());
+    }
+
+    for (unsigned int i = 0; i < num_threads; i++) {
+        this->workers.emplace_back(&ThreadPool::run, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> locker(this->idle_mtx);
+        this->running = false;
+    }
+    this->idle_cv.notify_all();
+
+    for (std::thread &w : this->workers) {
+        w.join();
+    }
+}
+
+unsigned int ThreadPool::get_num_threads()
+{
+    return this->workers.size();
+}
+
+ThreadPoolStats ThreadPool::get_stats()
+{
+    ThreadPoolStats stats;
+    stats.executed = this->executed;
+    stats.stolen = this->stolen;
+    return stats;
+}
+
+bool ThreadPool::in_worker()
+{
+    return worker_pool != nullptr;
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    unsigned int index = worker_pool == this ? worker_index :
+        this->next_queue++ % this->queues.size();
+
+    // Counted before it is published, so the worker that runs it can never
+    // decrement 'pending' below zero
+    this->pending++;
+    {
+        Queue &q = *this->queues[index];
+        std::lock_guard<std::mutex> locker(q.mtx);
+        q.tasks.push_back(std::move(task));
+    }
+
+    // Taking the lock orders the notification after a worker that saw no
+    // pending tasks went to sleep
+    {
+        std::lock_guard<std::mutex> locker(this->idle_mtx);
+    }
+    this->idle_cv.notify_one();
+}
+
+bool ThreadPool::pop(unsigned int index, std::function<void()> &task)
+{
+    // Newest task of our own queue first
+    {
+        Queue &q = *this->queues[index];
+        std::lock_guard<std::mutex> locker(q.mtx);
+        if (!q.tasks.empty()) {
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+            return true;
+        }
+    }
+
+    // Then the oldest task of the others
+    for (size_t i = 1; i < this->queues.size(); i++) {
+        Queue &q = *this->queues[(index + i) % this->queues.size()];
+        std::lock_guard<std::mutex> locker(q.mtx);
+        if (!q.tasks.empty()) {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            this->stolen++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::run(unsigned int index)
+{
+    worker_pool = this;
+    worker_index = index;
+
+    std::function<void()> task;
+
+    while (true) {
+        if (this->pop(index, task)) {
+            this->pending--;
+            task();
+            task = nullptr;
+            this->executed++;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> locker(this->idle_mtx);
+        this->idle_cv.wait(locker, [this]() {
+            return this->pending > 0 || !this->running;
+        });
+
+        if (!this->running && this->pending == 0) {
+            break;
+        }
+    }
+
+    worker_pool = nullptr;
+}
@@ -0,0 +1,89 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ThreadPoolStats {
+    // Tasks run to completion
+    uint64_t executed = 0;
+    // Tasks run by a worker other than the one whose queue they were on
+    uint64_t stolen = 0;
+};
+
+/**
+ * Work stealing thread pool.
+ *
+ * Each worker has its own task queue. Tasks submitted from a worker go to
+ * the back of its queue and are taken from the back (newest first), so a
+ * task that continues the work of the current one usually runs on the same
+ * core while its data is still in cache. Idle workers steal from the front
+ * (oldest first) of the other queues. Tasks submitted from outside the pool
+ * are spread round robin over the queues.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @param num_threads Number of workers, 0 means one per available core.
+     */
+    ThreadPool(unsigned int num_threads = 0);
+
+    /**
+     * @brief Run the tasks still queued and stop the workers.
+     */
+    ~ThreadPool();
+
+    void submit(std::function<void()> task);
+
+    unsigned int get_num_threads();
+    ThreadPoolStats get_stats();
+
+    /**
+     * @brief Whether the calling thread is a worker of any pool.
+     */
+    static bool in_worker();
+
+private:
+    struct Queue {
+        std::mutex mtx;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex idle_mtx;
+    std::condition_variable idle_cv;
+    std::atomic<size_t> pending;
+    std::atomic<bool> running;
+    std::atomic<unsigned int> next_queue;
+
+    std::atomic<uint64_t> executed;
+    std::atomic<uint64_t> stolen;
+
+    bool pop(unsigned int index, std::function<void()> &task);
+    void run(unsigned int index);
+};
@@ -0,0 +1,222 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <cmath>
+
+#include "DepthImageCollisionChecker.hh"
+
+DepthImageCollisionChecker::DepthImageCollisionChecker(double safety_radius)
+{
+    this->safety_radius = safety_radius;
+}
+
+void DepthImageCollisionChecker::update(std::shared_ptr<void> data)
+{
+    std::shared_ptr<DepthData> depth_data = std::static_pointer_cast<DepthData>(data);
+    const std::vector<uint16_t> &depth_buffer = depth_data->depth_buffer;
+
+    if (depth_buffer.size() == 0 ||
+            depth_buffer.size() != depth_data->width * depth_data->height) {
+        this->width = 0;
+        this->height = 0;
+        return;
+    }
+
+    this->width = depth_data->width;
+    this->height = depth_data->height;
+    this->scale = depth_data->scale;
+    this->hfov = depth_data->hfov;
+    this->vfov = depth_data->vfov;
+
+    this->build_levels(depth_buffer);
+}
+
+void DepthImageCollisionChecker::build_levels(
+        const std::vector<uint16_t> &depth_buffer)
+{
+    unsigned int w = this->width;
+    unsigned int h = this->height;
+    unsigned int n = 0;
+
+    // Level sizes are rounded up, so the last row or column of an odd level
+    // is taken alone
+    while (true) {
+        if (this->levels.size() <= n) {
+            this->levels.emplace_back();
+            this->level_width.push_back(0);
+            this->level_height.push_back(0);
+        }
+
+        this->level_width[n] = w;
+        this->level_height[n] = h;
+        this->levels[n].resize(w * h);
+        n++;
+
+        if (w == 1 && h == 1) {
+            break;
+        }
+
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+    }
+    this->levels.resize(n);
+    this->level_width.resize(n);
+    this->level_height.resize(n);
+
+    std::vector<uint16_t> &base = this->levels[0];
+    for (size_t i = 0; i < depth_buffer.size(); i++) {
+        base[i] = depth_buffer[i] - 1;
+    }
+
+    for (unsigned int l = 1; l < n; l++) {
+        const std::vector<uint16_t> &src = this->levels[l - 1];
+        std::vector<uint16_t> &dst = this->levels[l];
+        unsigned int sw = this->level_width[l - 1];
+        unsigned int sh = this->level_height[l - 1];
+
+        for (unsigned int i = 0; i < this->level_height[l]; i++) {
+            const uint16_t *row0 = &src[(2 * i) * sw];
+            const uint16_t *row1 = &src[glm::min(2 * i + 1, sh - 1) * sw];
+
+            for (unsigned int j = 0; j < this->level_width[l]; j++) {
+                unsigned int j1 = glm::min(2 * j + 1, sw - 1);
+                uint16_t a = glm::min(row0[2 * j], row0[j1]);
+                uint16_t b = glm::min(row1[2 * j], row1[j1]);
+                dst[i * this->level_width[l] + j] = glm::min(a, b);
+            }
+        }
+    }
+}
+
+bool DepthImageCollisionChecker::is_free(const glm::dvec3 &point)
+{
+    double dist = glm::length(point);
+
+    if (this->width == 0 || dist == 0) {
+        return true;
+    }
+
+    // Same angular model used by the detectors
+    double theta = acos(point.z / dist);
+    double phi = atan2(point.y, point.x);
+    double col = (1.0 - (phi - (M_PI - this->hfov) / 2) / this->hfov) * this->width;
+    double row = (theta - (M_PI - this->vfov) / 2) / this->vfov * this->height;
+
+    // Half angle covered by the sphere, the whole view if the camera is in it
+    double alpha = dist > this->safety_radius ?
+        asin(this->safety_radius / dist) : M_PI;
+    double half_cols = alpha / this->hfov * this->width;
+    double half_rows = alpha / this->vfov * this->height;
+
+    double x0 = glm::max(col - half_cols, 0.0);
+    double x1 = glm::min(col + half_cols, (double) this->width - 1);
+    double y0 = glm::max(row - half_rows, 0.0);
+    double y1 = glm::min(row + half_rows, (double) this->height - 1);
+
+    // Out of the field of view
+    if (point.y <= 0 || x0 > x1 || y0 > y1) {
+        return true;
+    }
+
+    // Finest level where the window spans at most two texels per axis
+    double extent = glm::max(x1 - x0, y1 - y0);
+    unsigned int level = extent > 1 ? (unsigned int) ceil(log2(extent)) : 0;
+    level = glm::min(level, (unsigned int) this->levels.size() - 1);
+
+    const std::vector<uint16_t> &texels = this->levels[level];
+    unsigned int lw = this->level_width[level];
+    unsigned int tx0 = (unsigned int) x0 >> level;
+    unsigned int tx1 = (unsigned int) x1 >> level;
+    unsigned int ty0 = (unsigned int) y0 >> level;
+    unsigned int ty1 = (unsigned int) y1 >> level;
+
+    uint16_t min = UINT16_MAX;
+    for (unsigned int ty = ty0; ty <= ty1; ty++) {
+        for (unsigned int tx = tx0; tx <= tx1; tx++) {
+            min = glm::min(min, texels[ty * lw + tx]);
+        }
+    }
+
+    if (min == UINT16_MAX) {
+        return true;
+    }
+
+    return (min + 1.0) * this->scale > dist + this->safety_radius;
+}
+
+bool DepthImageCollisionChecker::is_free(const glm::dvec3 &from,
+        const glm::dvec3 &to)
+{
+    // Spheres half a radius apart cover the whole segment
+    double length = glm::length(to - from);
+    int steps = (int) ceil(length / (this->safety_radius / 2.0));
+
+    for (int i = 0; i <= steps; i++) {
+        double t = steps ? (double) i / steps : 0.0;
+        if (!this->is_free(from + (to - from) * t)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool DepthImageCollisionChecker::in_view(const glm::dvec3 &point)
+{
+    double dist = glm::length(point);
+
+    if (this->width == 0) {
+        return false;
+    }
+
+    if (dist == 0) {
+        return true;
+    }
+
+    double theta = acos(point.z / dist);
+    double phi = atan2(point.y, point.x);
+    double col = (1.0 - (phi - (M_PI - this->hfov) / 2) / this->hfov) * this->width;
+    double row = (theta - (M_PI - this->vfov) / 2) / this->vfov * this->height;
+
+    return point.y > 0 && col >= 0 && col <= this->width && row >= 0 &&
+        row <= this->height;
+}
+
+double DepthImageCollisionChecker::free_length(const glm::dvec3 &from,
+        const glm::dvec3 &to)
+{
+    double length = glm::length(to - from);
+    int steps = (int) ceil(length / (this->safety_radius / 2.0));
+    double free = 0;
+
+    for (int i = 0; i <= steps; i++) {
+        double t = steps ? (double) i / steps : 0.0;
+        glm::dvec3 point = from + (to - from) * t;
+
+        if (!this->in_view(point) || !this->is_free(point)) {
+            break;
+        }
+
+        free = t * length;
+    }
+
+    return free;
+}
+
+double DepthImageCollisionChecker::get_hfov()
+{
+    return this->width ? this->hfov : 0;
+}
@@ -0,0 +1,87 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "sensors/Sensors.hh"
+
+/**
+ * Checks points and segments for collisions directly against a depth frame.
+ *
+ * A min-mipmap of the frame is built once per frame. A query projects a
+ * sphere around the point into the image, picks the mipmap level where the
+ * sphere covers at most two texels per axis and compares the closest depth
+ * of the covering texels with the distance to the point. So each check has
+ * a constant cost, regardless of the size of the sphere.
+ *
+ * Checks are conservative: anything closer than the far side of the sphere,
+ * including what hides it from the camera, is a collision. Points outside
+ * of the field of view can not be checked and count as free for is_free(),
+ * as do pixels with no depth reading. free_length() only accepts what is in
+ * view.
+ *
+ * Points are given in the sensor frame: x right, y forward, z up.
+ */
+class DepthImageCollisionChecker
+{
+public:
+    DepthImageCollisionChecker(double safety_radius = 1.0);
+
+    void update(std::shared_ptr<void> data);
+
+    bool is_free(const glm::dvec3 &point);
+    bool is_free(const glm::dvec3 &from, const glm::dvec3 &to);
+
+    /**
+     * @brief Whether a point is in the field of view of the last frame. The
+     * camera position itself is.
+     */
+    bool in_view(const glm::dvec3 &point);
+
+    /**
+     * @brief Length of the part of a segment, from its start, that is both
+     * in view and free. 0 if there is no frame.
+     */
+    double free_length(const glm::dvec3 &from, const glm::dvec3 &to);
+
+    /**
+     * @brief Horizontal field of view of the last frame, 0 if there is none.
+     */
+    double get_hfov();
+
+private:
+    double safety_radius;
+
+    // Level 0 is the frame itself. Depths are stored minus one, so invalid
+    // pixels become UINT16_MAX and never win a minimum.
+    std::vector<std::vector<uint16_t>> levels;
+    std::vector<unsigned int> level_width;
+    std::vector<unsigned int> level_height;
+
+    unsigned int width = 0;
+    unsigned int height = 0;
+    double scale = 0;
+    double hfov = 0;
+    double vfov = 0;
+
+    void build_levels(const std::vector<uint16_t> &depth_buffer);
+};
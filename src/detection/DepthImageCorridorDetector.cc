@@ -0,0 +1,136 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <cmath>
+#include <vector>
+
+#include "DepthImageCorridorDetector.hh"
+#include "common/common.hh"
+#include "common/simd.hh"
+
+DepthImageCorridorDetector::DepthImageCorridorDetector(double threshold_meters,
+        double corridor_width, double corridor_height)
+{
+    this->threshold = threshold_meters;
+    this->corridor_width = corridor_width;
+    this->corridor_height = corridor_height;
+}
+
+const std::vector<Obstacle> &DepthImageCorridorDetector::detect(
+        std::shared_ptr<void> data)
+{
+    std::shared_ptr<DepthData> depth_data = std::static_pointer_cast<DepthData>(data);
+    const std::vector<uint16_t> &depth_buffer = depth_data->depth_buffer;
+    unsigned int width = depth_data->width;
+    unsigned int height = depth_data->height;
+    double hfov = depth_data->hfov;
+    double vfov = depth_data->vfov;
+
+    this->obstacles.clear();
+
+    // Return if depth buffer is empty
+    if (depth_buffer.size() == 0 || depth_buffer.size() != width * height ||
+            depth_data->scale <= 0) {
+        return this->obstacles;
+    }
+
+    unsigned int x0, y0, x1, y1;
+    this->roi_window(width, height, hfov, vfov, x0, y0, x1, y1);
+
+    double focal_x = (width / 2.0) / tan(hfov / 2.0);
+    double focal_y = (height / 2.0) / tan(vfov / 2.0);
+    double half_width = this->corridor_width / 2.0;
+    double half_height = this->corridor_height / 2.0;
+
+    double center_col = (x0 + x1) / 2.0;
+    double center_row = (y0 + y1) / 2.0;
+
+    unsigned int roi_pixels = (x1 - x0) * (y1 - y0);
+
+    // The corridor covers the most pixels at the minimum distance
+    double half_cols = half_width / this->min_distance * focal_x;
+    double half_rows = half_height / this->min_distance * focal_y;
+
+    x0 = (unsigned int) glm::clamp(floor(center_col - half_cols), (double) x0, (double) x1);
+    x1 = (unsigned int) glm::clamp(ceil(center_col + half_cols), (double) x0, (double) x1);
+    y0 = (unsigned int) glm::clamp(floor(center_row - half_rows), (double) y0, (double) y1);
+    y1 = (unsigned int) glm::clamp(ceil(center_row + half_rows), (double) y0, (double) y1);
+
+    // A pixel at offset u from the center is inside the corridor up to the
+    // depth where u * z / f equals the half size, and never past the
+    // threshold. The limit of a pixel is the lowest of its column and row.
+    double max_depth = glm::min(this->threshold / depth_data->scale,
+            (double) UINT16_MAX);
+    auto depth_limit = [&](double offset, double half_size, double focal) {
+        double d = fabs(offset) > 0 ? half_size * focal / fabs(offset) /
+            depth_data->scale : max_depth;
+        return (uint16_t) glm::min(d, max_depth);
+    };
+
+    unsigned int cols = x1 - x0;
+    this->col_limit.resize(cols);
+    this->row_limits.resize(cols);
+    for (unsigned int j = 0; j < cols; j++) {
+        this->col_limit[j] = depth_limit(x0 + j + 0.5 - center_col,
+                half_width, focal_x);
+    }
+
+    size_t count = 0;
+    unsigned int i = y0;
+
+    while (i < y1 && count < this->min_num_pixels) {
+        uint16_t row_limit = depth_limit(i + 0.5 - center_row, half_height,
+                focal_y);
+        for (unsigned int j = 0; j < cols; j++) {
+            this->row_limits[j] = glm::min(this->col_limit[j], row_limit);
+        }
+
+        count += depth_count_below_each(&depth_buffer[i * width + x0],
+                this->row_limits.data(), cols);
+        i++;
+    }
+
+    // Pixels outside of the corridor or after the early exit were not read
+    unsigned int scanned = (i - y0) * cols;
+    this->stats.pixels_processed -= roi_pixels - scanned;
+    this->stats.pixels_skipped += roi_pixels - scanned;
+
+    if (count < this->min_num_pixels) {
+        return this->obstacles;
+    }
+
+    uint16_t min = UINT16_MAX;
+    for (unsigned int k = y0; k < i; k++) {
+        uint16_t row_limit = depth_limit(k + 0.5 - center_row, half_height,
+                focal_y);
+        for (unsigned int j = 0; j < cols; j++) {
+            this->row_limits[j] = glm::min(this->col_limit[j], row_limit);
+        }
+
+        uint16_t d = depth_min_below_each(&depth_buffer[k * width + x0],
+                this->row_limits.data(), cols) - 1;
+        min = d < min ? d : min;
+    }
+
+    Obstacle o;
+    o.id = 1;
+    o.center.x = (min + 1.0) * depth_data->scale;
+    o.center.y = ((center_row / height) * vfov) + (M_PI - vfov) / 2;
+    o.center.z = ((1.0 - (center_col / width)) * hfov) + (M_PI - hfov) / 2;
+    this->obstacles.push_back(o);
+
+    return this->obstacles;
+}
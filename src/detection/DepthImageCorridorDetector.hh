@@ -0,0 +1,67 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "detection/Detectors.hh"
+#include "sensors/Sensors.hh"
+
+/**
+ * Nearest obstacle in corridor detector.
+ *
+ * Only answers whether something lies closer than the threshold inside the
+ * corridor the vehicle is flying through, which is all the stop avoidance
+ * needs. The corridor is a box of the given cross section that extends from
+ * the camera up to the threshold distance, centered on the region of
+ * interest if one is set. A pixel belongs to it if its depth is within the
+ * threshold and its lateral and vertical offsets at that depth are within
+ * the half width and half height, so the image window scanned is sized for
+ * the minimum distance. Rows are scanned with a SIMD compare against a depth
+ * limit per pixel and the scan stops as soon as enough close pixels are
+ * found.
+ *
+ * At most one obstacle is returned. Its radial component is the closest
+ * distance seen in the scanned part of the corridor, which is not
+ * necessarily the closest one in the whole corridor.
+ */
+class DepthImageCorridorDetector : public Detector
+{
+public:
+    DepthImageCorridorDetector(double threshold_meters = 4.0,
+            double corridor_width = 1.0, double corridor_height = 0.6);
+    const std::vector<Obstacle> &detect(std::shared_ptr<void> data) override;
+
+private:
+    std::vector<Obstacle> obstacles;
+
+    // Depth limit of each column of the corridor, and of each pixel of the
+    // row being scanned, in depth units
+    std::vector<uint16_t> col_limit;
+    std::vector<uint16_t> row_limits;
+
+    double threshold;
+    double corridor_width;
+    double corridor_height;
+
+    // Closer than this the camera does not give valid depths
+    double min_distance = 0.3;
+    // Close pixels needed to report an obstacle, so noise is ignored
+    unsigned int min_num_pixels = 64;
+};
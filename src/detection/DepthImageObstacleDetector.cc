@@ -14,12 +14,14 @@
 // limitations under the License.
 */
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <vector>
 
 #include "DepthImageObstacleDetector.hh"
 #include "common/common.hh"
+#include "common/simd.hh"
 
 #define MAX_NUM_LABELS UINT16_MAX
 #define BACKGROUND 0
@@ -112,6 +114,13 @@ DepthImageObstacleDetector::DepthImageObstacleDetector(double threshold_meters)
     this->threshold = threshold_meters;
 }
 
+void DepthImageObstacleDetector::set_coarse_to_fine(unsigned int decimation,
+        double trigger_distance)
+{
+    this->decimation = decimation;
+    this->trigger_distance = trigger_distance;
+}
+
 const std::vector<Obstacle> &DepthImageObstacleDetector::detect(std::shared_ptr<void> data)
 {
     std::shared_ptr<DepthData> depth_data = std::static_pointer_cast<DepthData>(data);
@@ -125,8 +134,17 @@ const std::vector<Obstacle> &DepthImageObstacleDetector::detect(std::shared_ptr<
     this->base_phi = (M_PI - hfov) / 2;
     this->base_theta = (M_PI - vfov) / 2;
 
+    unsigned int x0, y0, x1, y1;
+    this->roi_window(this->width, this->height, this->hfov, this->vfov,
+            x0, y0, x1, y1);
+    this->frame_roi = Window{(int) x0, (int) y0, (int) (x1 - x0), (int) (y1 - y0)};
+
     // Detect obstacles from current depth buffer
-    this->extract_blobs();
+    if (this->decimation > 1) {
+        this->extract_blobs_coarse_to_fine();
+    } else {
+        this->extract_blobs();
+    }
 
     return this->obstacles;
 }
@@ -147,15 +165,18 @@ int DepthImageObstacleDetector::get_neighbors_label(const int i, const int j, st
     int pixel_idx, north_idx;
     int neighbor_idx = 0;
 
-    if (i < 0 || i >= this->height || j < 0 || j >= this->width) {
+    const Window &w = this->window;
+    const uint16_t *depth_frame = this->frame;
+
+    if (i < w.y || i >= w.y + w.height || j < w.x || j >= w.x + w.width) {
         return 0;
     }
 
-    pixel_idx = i * this->width + j;
-    north_idx = pixel_idx - this->width;
+    pixel_idx = i * this->frame_width + j;
+    north_idx = pixel_idx - this->frame_width;
 
     /* Check west */
-    if (j > 0) {
+    if (j > w.x) {
         if (is_in_range(depth_frame[pixel_idx - 1], depth_frame[pixel_idx])) {
             neigh_labels[neighbor_idx] = this->labels[pixel_idx - 1];
             neighbor_idx++;
@@ -163,7 +184,7 @@ int DepthImageObstacleDetector::get_neighbors_label(const int i, const int j, st
     }
 
     /* Check northwest */
-    if (j > 0 && i > 0) {
+    if (j > w.x && i > w.y) {
         if (is_in_range(depth_frame[north_idx - 1], depth_frame[pixel_idx])) {
             neigh_labels[neighbor_idx] = this->labels[north_idx - 1];
             neighbor_idx++;
@@ -171,7 +192,7 @@ int DepthImageObstacleDetector::get_neighbors_label(const int i, const int j, st
     }
 
     /* Check north */
-    if (i > 0) {
+    if (i > w.y) {
         if (is_in_range(depth_frame[north_idx], depth_frame[pixel_idx])) {
             neigh_labels[neighbor_idx] = this->labels[north_idx];
             neighbor_idx++;
@@ -179,7 +200,7 @@ int DepthImageObstacleDetector::get_neighbors_label(const int i, const int j, st
     }
 
     /* Check northeast */
-    if (i > 0 && j < (this->width - 1)) {
+    if (i > w.y && j < (w.x + w.width - 1)) {
         if (is_in_range(depth_frame[north_idx + 1], depth_frame[pixel_idx])) {
             neigh_labels[neighbor_idx] = this->labels[north_idx + 1];
             neighbor_idx++;
@@ -199,47 +220,59 @@ int DepthImageObstacleDetector::get_neighbors_label(const int i, const int j, st
     return neighbor_idx;
 }
 
-void init_obstacle_array(std::vector<Obstacle> &obstacles)
-{
-    obstacles.resize(MAX_NUM_LABELS);
-    for (unsigned int i = 0; i < obstacles.size(); ++i) {
-        obstacles[i].id = -1;
-        obstacles[i].center = glm::dvec3(-1, -1, -1);
-    }
-}
-
 int DepthImageObstacleDetector::extract_blobs()
 {
-    int row_offset;
-
     // Check if the current stored depth frame is valid
     if (depth_frame.size() == 0) {
         obstacles.resize(0);
         return 0;
     }
 
+    this->obstacles.clear();
+    this->obstacle_bounds.clear();
+
+    return extract_blobs(this->depth_frame.data(), this->width, this->height,
+            this->frame_roi, this->min_num_pixels, this->obstacles,
+            this->obstacle_bounds);
+}
+
+int DepthImageObstacleDetector::extract_blobs(const uint16_t *frame,
+        int frame_width, int frame_height, const Window &window,
+        int min_pixels, std::vector<Obstacle> &out,
+        std::vector<Window> &out_bounds)
+{
+    int row_offset;
+    int first_obstacle = out.size();
+    int num_obstacles = first_obstacle;
+
+    this->frame = frame;
+    this->frame_width = frame_width;
+    this->frame_height = frame_height;
+    this->window = window;
+
+    // Labels are at most one per pixel of the window, label 0 is background
+    int num_labels = std::min(window.width * window.height + 1, MAX_NUM_LABELS);
+
     // Instantiate disjoint data set
-    PPTree ds_tree(MAX_NUM_LABELS);
+    PPTree ds_tree(num_labels);
 
     // Store number of pixels for each blob
-    int blob_num_pixels[MAX_NUM_LABELS] = {0};
+    this->blob_num_pixels.assign(num_labels, 0);
 
     // Blob to Obstacle Vector
-    int blob_to_obstacle[MAX_NUM_LABELS];
-    int num_obstacles = 0;
+    this->blob_to_obstacle.assign(num_labels, -1);
     uint16_t curr_label = 1;
 
-    // Init Obstacles vector and labels vector
-    init_obstacle_array(obstacles);
-    this->labels.resize(depth_frame.size());
+    // Init labels vector
+    this->labels.resize(frame_width * frame_height);
 
-    // First Pass
-    for (int i = 0; i < this->height; i++) {
-        row_offset = i * this->width;
-        for (int j = 0; j < this->width; j++) {
-            if (is_valid(this->depth_frame[row_offset + j])) {
-                std::vector<int> neigh_labels(4);
+    std::vector<int> neigh_labels(4);
 
+    // First Pass
+    for (int i = window.y; i < window.y + window.height; i++) {
+        row_offset = i * frame_width;
+        for (int j = window.x; j < window.x + window.width; j++) {
+            if (is_valid(frame[row_offset + j])) {
                 int num_neighbors = get_neighbors_label(i, j, neigh_labels);
                 if (num_neighbors) {
                     this->labels[row_offset + j] = neigh_labels[0];
@@ -247,7 +280,7 @@ int DepthImageObstacleDetector::extract_blobs()
                         ds_tree.ds_union(neigh_labels[0], neigh_labels[k]);
                     }
                 } else {
-                    this->labels[row_offset + j] = (curr_label <= MAX_NUM_LABELS) ? curr_label++ : 0;
+                    this->labels[row_offset + j] = (curr_label < num_labels) ? curr_label++ : 0;
                 }
             } else {
                 this->labels[row_offset + j] = 0;
@@ -256,26 +289,25 @@ int DepthImageObstacleDetector::extract_blobs()
     }
 
     /* Second Pass. */
-    for (unsigned int i = 0; i < labels.size(); i++) {
-        if (this->labels[i]) {
-            this->labels[i] = ds_tree.ds_find(this->labels[i]);
-            blob_num_pixels[this->labels[i]]++;
+    for (int i = window.y; i < window.y + window.height; i++) {
+        row_offset = i * frame_width;
+        for (int j = window.x; j < window.x + window.width; j++) {
+            uint16_t &label = this->labels[row_offset + j];
+            if (label) {
+                label = ds_tree.ds_find(label);
+                blob_num_pixels[label]++;
+            }
         }
     }
 
-    /* Initialize blob to obstacle vector. */
-    for (int i = 0; i < MAX_NUM_LABELS; i++) {
-        blob_to_obstacle[i] = -1;
-    }
-
     /* Third Pass */
 
-    for (int i = 0; i < this->height; i++) {
-        row_offset = i * this->width;
-        for (int j = 0; j < this->width; j++) {
+    for (int i = window.y; i < window.y + window.height; i++) {
+        row_offset = i * frame_width;
+        for (int j = window.x; j < window.x + window.width; j++) {
             int label = this->labels[row_offset + j];
 
-            if (!label || blob_num_pixels[label] < this->min_num_pixels)
+            if (!label || blob_num_pixels[label] < min_pixels)
                 continue;
 
             if (blob_to_obstacle[label] == -1) {
@@ -283,28 +315,169 @@ int DepthImageObstacleDetector::extract_blobs()
                     continue;
 
                 blob_to_obstacle[label] = num_obstacles++;
-                obstacles[blob_to_obstacle[label]].id = label;
-                obstacles[blob_to_obstacle[label]].center.x = DBL_MAX;
+
+                Obstacle o;
+                o.id = label;
+                o.center = glm::dvec3(DBL_MAX, 0, 0);
+                out.push_back(o);
+                out_bounds.push_back(Window{j, i, 1, 1});
             }
 
-            Obstacle *o = &obstacles[blob_to_obstacle[label]];
+            Obstacle *o = &out[blob_to_obstacle[label]];
             o->center += glm::dvec3(0, i, j);
-            o->center.x = (depth_frame[row_offset + j] < o->center.x) ?
-                depth_frame[row_offset + j] : o->center.x;
+            o->center.x = (frame[row_offset + j] < o->center.x) ?
+                frame[row_offset + j] : o->center.x;
+
+            // Grow the bounding box, rows are visited in order
+            Window &b = out_bounds[blob_to_obstacle[label]];
+            if (j < b.x) {
+                b.width += b.x - j;
+                b.x = j;
+            } else if (j >= b.x + b.width) {
+                b.width = j - b.x + 1;
+            }
+            b.height = i - b.y + 1;
         }
     }
 
-    this->obstacles.resize(num_obstacles);
-    for (Obstacle &o : obstacles) {
+    for (int k = first_obstacle; k < num_obstacles; k++) {
+        Obstacle &o = out[k];
         o.center.x *= this->scale;
         o.center.y /= blob_num_pixels[o.id];
         o.center.z /= blob_num_pixels[o.id];
 
         // Cartesian to spherical
-        o.center.y = ((o.center.y / this->height) * vfov) + base_theta;
-        o.center.z = ((1.0 - (o.center.z / this->width)) * hfov) + base_phi;
+        o.center.y = ((o.center.y / frame_height) * vfov) + base_theta;
+        o.center.z = ((1.0 - (o.center.z / frame_width)) * hfov) + base_phi;
     }
 
-    return num_obstacles;
+    return num_obstacles - first_obstacle;
 }
 
+int DepthImageObstacleDetector::extract_blobs_coarse_to_fine()
+{
+    this->obstacles.clear();
+    this->obstacle_bounds.clear();
+
+    // Check if the current stored depth frame is valid
+    if (depth_frame.size() == 0) {
+        return 0;
+    }
+
+    int f = this->decimation;
+    int coarse_width = this->width / f;
+    int coarse_height = this->height / f;
+
+    // Region of interest in coarse pixels
+    const Window &roi = this->frame_roi;
+    int cx0 = roi.x / f;
+    int cy0 = roi.y / f;
+    int cx1 = std::min(coarse_width, (roi.x + roi.width + f - 1) / f);
+    int cy1 = std::min(coarse_height, (roi.y + roi.height + f - 1) / f);
+    cx1 = std::max(cx0, cx1);
+    cy1 = std::max(cy0, cy1);
+
+    // Decimate keeping the closest valid depth of each block, so that thin
+    // obstacles are not lost. The vertical reduction runs first, over
+    // contiguous memory.
+    this->coarse_frame.resize(coarse_width * coarse_height);
+    this->column_min.resize(this->width);
+    for (int ci = cy0; ci < cy1; ci++) {
+        uint16_t *coarse_row = &this->coarse_frame[ci * coarse_width];
+        uint16_t *col_min = this->column_min.data();
+        int first = cx0 * f;
+        int count = (cx1 - cx0) * f;
+
+        std::fill(col_min + first, col_min + first + count, BACKGROUND);
+        for (int i = ci * f; i < (ci + 1) * f; i++) {
+            depth_min_accumulate(col_min + first,
+                    &this->depth_frame[i * this->width + first], count);
+        }
+
+        for (int cj = cx0; cj < cx1; cj++) {
+            coarse_row[cj] = depth_min(&col_min[cj * f], f);
+        }
+    }
+
+    // Coarse pass
+    this->coarse_obstacles.clear();
+    this->coarse_bounds.clear();
+    Window coarse_window = {cx0, cy0, cx1 - cx0, cy1 - cy0};
+    extract_blobs(this->coarse_frame.data(), coarse_width, coarse_height,
+            coarse_window, std::max(1, this->min_num_pixels / (f * f)),
+            this->coarse_obstacles, this->coarse_bounds);
+
+    // Regions of interest around close blobs, in full resolution pixels
+    this->rois.clear();
+    std::vector<bool> refined(this->coarse_obstacles.size(), false);
+    for (size_t k = 0; k < this->coarse_obstacles.size(); k++) {
+        if (this->trigger_distance &&
+                this->coarse_obstacles[k].center.x > this->trigger_distance)
+            continue;
+
+        const Window &b = this->coarse_bounds[k];
+        int x0 = std::max(roi.x, b.x * f - this->roi_margin);
+        int y0 = std::max(roi.y, b.y * f - this->roi_margin);
+        int x1 = std::min(roi.x + roi.width, (b.x + b.width) * f + this->roi_margin);
+        int y1 = std::min(roi.y + roi.height, (b.y + b.height) * f + this->roi_margin);
+
+        this->rois.push_back(Window{x0, y0, x1 - x0, y1 - y0});
+        refined[k] = true;
+    }
+
+    // Merge overlapping regions so that no blob is labeled twice
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t a = 0; a < this->rois.size() && !merged; a++) {
+            for (size_t b = a + 1; b < this->rois.size() && !merged; b++) {
+                Window &ra = this->rois[a];
+                Window &rb = this->rois[b];
+                if (ra.x >= rb.x + rb.width || rb.x >= ra.x + ra.width ||
+                        ra.y >= rb.y + rb.height || rb.y >= ra.y + ra.height)
+                    continue;
+
+                int x0 = std::min(ra.x, rb.x);
+                int y0 = std::min(ra.y, rb.y);
+                int x1 = std::max(ra.x + ra.width, rb.x + rb.width);
+                int y1 = std::max(ra.y + ra.height, rb.y + rb.height);
+                ra = Window{x0, y0, x1 - x0, y1 - y0};
+                this->rois.erase(this->rois.begin() + b);
+                merged = true;
+            }
+        }
+    }
+
+    // Fine pass
+    for (const Window &r : this->rois) {
+        extract_blobs(this->depth_frame.data(), this->width, this->height, r,
+                this->min_num_pixels, this->obstacles, this->obstacle_bounds);
+    }
+
+    // Far blobs keep their coarse estimate unless they are inside a region
+    // that has already been refined
+    for (size_t k = 0; k < this->coarse_obstacles.size(); k++) {
+        if (refined[k] || (int) this->obstacles.size() >= this->max_num_obstacles)
+            continue;
+
+        const Window &b = this->coarse_bounds[k];
+        int cx = (b.x + b.width / 2) * f;
+        int cy = (b.y + b.height / 2) * f;
+        bool inside = false;
+        for (const Window &r : this->rois) {
+            inside |= cx >= r.x && cx < r.x + r.width &&
+                cy >= r.y && cy < r.y + r.height;
+        }
+
+        if (!inside) {
+            this->obstacles.push_back(this->coarse_obstacles[k]);
+        }
+    }
+
+    // Labels are only unique within one labeling run
+    for (size_t k = 0; k < this->obstacles.size(); k++) {
+        this->obstacles[k].id = k + 1;
+    }
+
+    return this->obstacles.size();
+}
@@ -28,10 +28,34 @@ public:
     DepthImageObstacleDetector(double threshold_meters = 0.0);
     const std::vector<Obstacle> &detect(std::shared_ptr<void> data) override;
 
+    /**
+     * @brief Enable coarse-to-fine detection.
+     *
+     * Blobs are first extracted from a frame decimated by 'decimation' in
+     * both directions. Full resolution labeling is then only run inside a
+     * region around each coarse blob closer than 'trigger_distance' meters.
+     * Farther blobs are reported with the coarse precision.
+     *
+     * @param decimation Decimation factor, 0 or 1 disables coarse-to-fine.
+     * @param trigger_distance Distance in meters below which coarse blobs are
+     * refined. If 0, every coarse blob is refined.
+     */
+    void set_coarse_to_fine(unsigned int decimation, double trigger_distance = 0.0);
+
 private:
+    struct Window {
+        int x;
+        int y;
+        int width;
+        int height;
+    };
+
     std::vector<Obstacle> obstacles;
+    std::vector<Window> obstacle_bounds;
     std::vector<uint16_t> depth_frame;
     std::vector<uint16_t> labels;
+    std::vector<int> blob_num_pixels;
+    std::vector<int> blob_to_obstacle;
     int width;
     int height;
     double hfov;
@@ -40,12 +64,35 @@ private:
     double base_theta;
     double base_phi;
 
+    // Frame currently being labeled and its dimensions
+    const uint16_t *frame = nullptr;
+    int frame_width = 0;
+    int frame_height = 0;
+    Window window = {0, 0, 0, 0};
+
+    // Pixels covered by the region of interest
+    Window frame_roi = {0, 0, 0, 0};
+
+    // Coarse-to-fine state
+    unsigned int decimation = 0;
+    double trigger_distance = 0.0;
+    int roi_margin = 8;
+    std::vector<uint16_t> coarse_frame;
+    std::vector<uint16_t> column_min;
+    std::vector<Obstacle> coarse_obstacles;
+    std::vector<Window> coarse_bounds;
+    std::vector<Window> rois;
+
     bool is_valid(const uint16_t depth);
     bool is_in_range(const uint16_t d1, const uint16_t d2);
 
     int get_neighbors_label(const int i, const int j, std::vector<int> &neigh_labels);
 
     int extract_blobs();
+    int extract_blobs(const uint16_t *frame, int frame_width, int frame_height,
+            const Window &window, int min_pixels, std::vector<Obstacle> &out,
+            std::vector<Window> &out_bounds);
+    int extract_blobs_coarse_to_fine();
 
     double calc_pixel_area(int i, int j, uint16_t depth_value);
 
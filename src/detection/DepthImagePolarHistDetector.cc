@@ -32,15 +32,30 @@ DepthImagePolarHistDetector::DepthImagePolarHistDetector(double angle_step,
     this->density = density;
 }
 
+const std::vector<double> &DepthImagePolarHistDetector::get_histogram()
+{
+    return this->histogram;
+}
+
+double DepthImagePolarHistDetector::get_slice_width()
+{
+    return this->slice_width;
+}
+
+double DepthImagePolarHistDetector::get_threshold()
+{
+    return this->threshold;
+}
+
 const std::vector<Obstacle> &DepthImagePolarHistDetector::detect(
         std::shared_ptr<void> data)
 {
     std::shared_ptr<DepthData> depth_data = std::static_pointer_cast<DepthData>(data);
-    std::vector<double> histogram;
-    std::vector<unsigned int> density_count;
+    std::vector<double> &histogram = this->histogram;
+    std::vector<unsigned int> &density_count = this->density_count;
 
     // Obtain camera depth buffer and camera properties
-    std::vector<uint16_t> depth_buffer = depth_data->depth_buffer;
+    const std::vector<uint16_t> &depth_buffer = depth_data->depth_buffer;
     unsigned int height = depth_data->height;
     unsigned int width = depth_data->width;
     double fov = depth_data->hfov;
@@ -52,6 +67,7 @@ const std::vector<Obstacle> &DepthImagePolarHistDetector::detect(
 
     // Return if depth buffer is empty
     if(depth_buffer.size() == 0) {
+        histogram.clear();
         return this->obstacles;
     }
 
@@ -61,14 +77,19 @@ const std::vector<Obstacle> &DepthImagePolarHistDetector::detect(
         glm::min(defaults::vertical_sweep_pixels, middle_row);
 
     // Create one entry for each slice of the fov and initialize to max distance
-    histogram.resize(glm::ceil(fov / this->step), UINT16_MAX * scale);
-    density_count.resize(histogram.size(), 0);
+    histogram.assign(glm::ceil(fov / this->step), UINT16_MAX * scale);
+    density_count.assign(histogram.size(), 0);
+
+    // Only the part of the slice inside the region of interest is swept
+    unsigned int x0, y0, x1, y1;
+    this->roi_window(width, height, fov, depth_data->vfov, x0, y0, x1, y1);
+    unsigned int first_row = glm::max(middle_row - vertical_sweep_pixels, y0);
+    unsigned int last_row = glm::min(middle_row + vertical_sweep_pixels, y1);
 
     // Sweep a slice of the depth buffer filling up the histogram with the
     // closest distance found in a given direction
-    for (unsigned int i = (middle_row - vertical_sweep_pixels);
-         i < (middle_row + vertical_sweep_pixels); i++) {
-        for (unsigned int j = 0; j < width; j++) {
+    for (unsigned int i = first_row; i < last_row; i++) {
+        for (unsigned int j = x0; j < x1; j++) {
             unsigned int pos = ((double) j / (double) width) * histogram.size();
 
             uint16_t depth_value = depth_buffer[i * width + j];
@@ -86,6 +107,7 @@ const std::vector<Obstacle> &DepthImagePolarHistDetector::detect(
     // we use equal sized slices, so the actual step may be smaller than the provided
     // step if fov is not a multiple of it.
     double fixed_step = fov / histogram.size();
+    this->slice_width = fixed_step;
     unsigned int slice_pixel_count = (vertical_sweep_pixels * 2) * (width / histogram.size());
 
     // Assuming the drone is always looking down the y axis, calculate
@@ -94,8 +116,10 @@ const std::vector<Obstacle> &DepthImagePolarHistDetector::detect(
 
     for (size_t i = 0; i < histogram.size(); i++) {
         if (histogram[i] > this->threshold ||
-                ((double) density_count[i]) / slice_pixel_count < this->density)
+                ((double) density_count[i]) / slice_pixel_count < this->density) {
+            histogram[i] = UINT16_MAX * scale;
             continue;
+        }
         // Scan is made from left to right, so position 0 will be at the biggest phi
         // We center the phi in the middle of the slice
         double phi = max_phi - (i * fixed_step) - (fixed_step / 2);
@@ -29,9 +29,26 @@ public:
             double threshold = 5.0, double density = 0.1);
     const std::vector<Obstacle> &detect(std::shared_ptr<void> data) override;
 
+    /**
+     * @brief Closest distance in each slice of the field of view, from left
+     * to right, as of the last call to detect(). Slices without an obstacle
+     * are farther than the threshold.
+     */
+    const std::vector<double> &get_histogram();
+
+    /**
+     * @brief Angular width of each slice of the histogram, in radians.
+     */
+    double get_slice_width();
+
+    double get_threshold();
+
 private:
     double step;
     double threshold;
     double density;
+    double slice_width = 0;
     std::vector<Obstacle> obstacles;
+    std::vector<double> histogram;
+    std::vector<unsigned int> density_count;
 };
@@ -0,0 +1,189 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "DepthImageTTCDetector.hh"
+#include "common/common.hh"
+#include "common/parallel.hh"
+
+DepthImageTTCDetector::DepthImageTTCDetector(double ttc_horizon_sec,
+        double threshold_meters, unsigned int tile_size)
+{
+    this->ttc_horizon = ttc_horizon_sec;
+    this->threshold = threshold_meters;
+    this->tile_size = glm::max(tile_size, 1u);
+}
+
+const std::vector<double> &DepthImageTTCDetector::get_time_to_collision()
+{
+    return this->ttc;
+}
+
+void DepthImageTTCDetector::compute_tile_min(
+        const std::vector<uint16_t> &depth_buffer, size_t first_row,
+        size_t last_row)
+{
+    for (size_t ty = first_row; ty < last_row; ty++) {
+        // Only the part of the tile inside the region of interest is used
+        unsigned int i_begin = glm::max((unsigned int) ty * this->tile_size, this->y0);
+        unsigned int i_end = glm::min((unsigned int) (ty + 1) * this->tile_size,
+                this->y1);
+
+        for (unsigned int tx = 0; tx < this->tiles_x; tx++) {
+            unsigned int j_begin = glm::max(tx * this->tile_size, this->x0);
+            unsigned int j_end = glm::min((tx + 1) * this->tile_size, this->x1);
+
+            // Invalid pixels (0) wrap around to UINT16_MAX when one is
+            // subtracted, so the minimum can be taken without branches
+            uint16_t min = UINT16_MAX;
+            for (unsigned int i = i_begin; i < i_end; i++) {
+                const uint16_t *row = &depth_buffer[i * this->width];
+                for (unsigned int j = j_begin; j < j_end; j++) {
+                    uint16_t d = row[j] - 1;
+                    min = d < min ? d : min;
+                }
+            }
+
+            this->tile_min[ty * this->tiles_x + tx] = min;
+            this->tile_window[ty * this->tiles_x + tx] =
+                (uint64_t) i_begin << 48 | (uint64_t) i_end << 32 |
+                (uint64_t) j_begin << 16 | j_end;
+        }
+    }
+}
+
+const std::vector<Obstacle> &DepthImageTTCDetector::detect(
+        std::shared_ptr<void> data)
+{
+    std::shared_ptr<DepthData> depth_data = std::static_pointer_cast<DepthData>(data);
+    const std::vector<uint16_t> &depth_buffer = depth_data->depth_buffer;
+
+    this->obstacles.clear();
+    this->ttc.clear();
+
+    // Return if depth buffer is empty
+    if (depth_buffer.size() == 0 ||
+            depth_buffer.size() != depth_data->width * depth_data->height) {
+        return this->obstacles;
+    }
+
+    // Reset tracking if the camera geometry changed
+    if (depth_data->width != this->width || depth_data->height != this->height) {
+        this->width = depth_data->width;
+        this->height = depth_data->height;
+        this->tiles_x = (this->width + this->tile_size - 1) / this->tile_size;
+        this->tiles_y = (this->height + this->tile_size - 1) / this->tile_size;
+        this->tiles.assign(this->tiles_x * this->tiles_y,
+                Tile{0.0, 0.0, 0, false, false});
+        this->tile_min.resize(this->tiles.size());
+        this->tile_window.resize(this->tiles.size());
+    }
+
+    double dt = std::chrono::duration<double>(
+            depth_data->timestamp - this->last_timestamp).count();
+    bool consecutive = dt > 0 && dt <= this->max_frame_interval;
+
+    // A repeated frame carries no motion information
+    if (dt == 0) {
+        return this->obstacles;
+    }
+    this->last_timestamp = depth_data->timestamp;
+
+    this->roi_window(this->width, this->height, depth_data->hfov,
+            depth_data->vfov, this->x0, this->y0, this->x1, this->y1);
+
+    // Tile rows are independent of each other
+    parallel_for(this->tiles_y, [&](size_t begin, size_t end) {
+        this->compute_tile_min(depth_buffer, begin, end);
+    });
+
+    double scale = depth_data->scale;
+    double hfov = depth_data->hfov;
+    double vfov = depth_data->vfov;
+    double base_phi = (M_PI - hfov) / 2;
+    double base_theta = (M_PI - vfov) / 2;
+
+    std::vector<double> tile_ttc(this->tiles.size(), INFINITY);
+
+    for (size_t k = 0; k < this->tiles.size(); k++) {
+        Tile &tile = this->tiles[k];
+        double depth = (this->tile_min[k] + 1.0) * scale;
+        bool valid = this->tile_min[k] != UINT16_MAX && depth <= this->threshold;
+
+        if (!valid) {
+            tile.valid = false;
+            tile.tracked = false;
+            continue;
+        }
+
+        // The region of interest moved over the tile, so the new minimum is
+        // taken from other pixels
+        if (tile.valid && tile.window != this->tile_window[k]) {
+            tile.valid = false;
+        }
+
+        if (tile.valid && consecutive) {
+            double speed = (tile.depth - depth) / dt;
+            tile.closing_speed = tile.tracked ?
+                glm::mix(tile.closing_speed, speed, this->speed_filter) : speed;
+            tile.tracked = true;
+        } else {
+            tile.closing_speed = 0;
+            tile.tracked = false;
+        }
+
+        tile.depth = depth;
+        tile.window = this->tile_window[k];
+        tile.valid = true;
+
+        if (tile.tracked && tile.closing_speed > this->min_closing_speed) {
+            tile_ttc[k] = depth / tile.closing_speed;
+        }
+    }
+
+    // Rank the tiles within the horizon by time to collision
+    this->order.clear();
+    for (size_t k = 0; k < this->tiles.size(); k++) {
+        if (tile_ttc[k] <= this->ttc_horizon) {
+            this->order.push_back(k);
+        }
+    }
+
+    std::sort(this->order.begin(), this->order.end(), [&](size_t a, size_t b) {
+        return tile_ttc[a] < tile_ttc[b];
+    });
+
+    for (size_t k : this->order) {
+        double row = (k / this->tiles_x + 0.5) * this->tile_size;
+        double col = (k % this->tiles_x + 0.5) * this->tile_size;
+        row = glm::min(row, (double) this->height);
+        col = glm::min(col, (double) this->width);
+
+        Obstacle o;
+        o.id = k + 1;
+        o.center.x = this->tiles[k].depth;
+        o.center.y = ((row / this->height) * vfov) + base_theta;
+        o.center.z = ((1.0 - (col / this->width)) * hfov) + base_phi;
+
+        this->obstacles.push_back(o);
+        this->ttc.push_back(tile_ttc[k]);
+    }
+
+    return this->obstacles;
+}
@@ -0,0 +1,99 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "detection/Detectors.hh"
+#include "sensors/Sensors.hh"
+
+/**
+ * Time-to-collision detector.
+ *
+ * The depth image is divided in square tiles and the minimum depth of each
+ * tile is tracked between consecutive frames. The closing speed of a tile
+ * divided by its distance gives the time left until contact. Tiles that
+ * would be reached within the time horizon are returned as obstacles,
+ * sorted by time to collision, most urgent first. Obstacle ids are the tile
+ * index plus one, so they are stable between frames.
+ *
+ * With a region of interest, only the part of a tile inside it is used. A
+ * tile is only tracked while that part stays the same, since the minimum
+ * of a different set of pixels does not tell how fast the scene closes in.
+ */
+class DepthImageTTCDetector : public Detector
+{
+public:
+    DepthImageTTCDetector(double ttc_horizon_sec = 3.0,
+            double threshold_meters = 10.0, unsigned int tile_size = 32);
+    const std::vector<Obstacle> &detect(std::shared_ptr<void> data) override;
+
+    /**
+     * @brief Time to collision, in seconds, of each obstacle returned by the
+     * last call to detect(), in the same order.
+     */
+    const std::vector<double> &get_time_to_collision();
+
+private:
+    struct Tile {
+        double depth;
+        double closing_speed;
+        // Part of the tile the depth was taken from, see tile_window
+        uint64_t window;
+        bool valid;
+        bool tracked;
+    };
+
+    std::vector<Obstacle> obstacles;
+    std::vector<double> ttc;
+    std::vector<Tile> tiles;
+    std::vector<uint16_t> tile_min;
+    // Part of each tile inside the region of interest on the current frame,
+    // packed as 16 bit row and column bounds
+    std::vector<uint64_t> tile_window;
+    std::vector<size_t> order;
+
+    unsigned int width = 0;
+    unsigned int height = 0;
+    unsigned int tiles_x = 0;
+    unsigned int tiles_y = 0;
+
+    // Region of interest, [x0, x1) x [y0, y1)
+    unsigned int x0 = 0;
+    unsigned int y0 = 0;
+    unsigned int x1 = 0;
+    unsigned int y1 = 0;
+
+    std::chrono::steady_clock::time_point last_timestamp;
+
+    void compute_tile_min(const std::vector<uint16_t> &depth_buffer,
+            size_t first_row, size_t last_row);
+
+    double ttc_horizon;
+    double threshold;
+    unsigned int tile_size;
+
+    // Weight of the newest sample on the closing speed low pass filter
+    double speed_filter = 0.5;
+    // Closing speeds below this are considered noise
+    double min_closing_speed = 0.1;
+    // Frames further apart than this are not used to compute speeds
+    double max_frame_interval = 0.5;
+};
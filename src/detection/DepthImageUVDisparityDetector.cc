@@ -0,0 +1,340 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "DepthImageUVDisparityDetector.hh"
+#include "common/common.hh"
+
+#define INVALID_BIN 0
+
+namespace defaults
+{
+// Minimum number of rows with a ground candidate to accept a ground fit
+const unsigned int min_ground_rows = 10;
+// Fraction of a row that must share the same bin to be a ground candidate
+const double ground_row_fraction = 0.25;
+// Minimum height in pixels of a column to be considered part of an obstacle
+const unsigned int min_column_pixels = 3;
+}
+
+DepthImageUVDisparityDetector::DepthImageUVDisparityDetector(
+        double threshold_meters, unsigned int num_bins)
+{
+    this->threshold = threshold_meters;
+    this->num_bins = glm::clamp(num_bins, 2u, (unsigned int) UINT8_MAX);
+}
+
+const std::vector<Obstacle> &DepthImageUVDisparityDetector::detect(
+        std::shared_ptr<void> data)
+{
+    std::shared_ptr<DepthData> depth_data = std::static_pointer_cast<DepthData>(data);
+    const std::vector<uint16_t> &depth_buffer = depth_data->depth_buffer;
+
+    this->obstacles.clear();
+
+    // Return if depth buffer is empty
+    if (depth_buffer.size() == 0 ||
+            depth_buffer.size() != depth_data->width * depth_data->height) {
+        return this->obstacles;
+    }
+
+    // Lookup tables only depend on camera properties
+    if (depth_data->width != this->width || depth_data->height != this->height ||
+            depth_data->scale != this->scale || depth_data->vfov != this->vfov) {
+        this->width = depth_data->width;
+        this->height = depth_data->height;
+        this->scale = depth_data->scale;
+        this->vfov = depth_data->vfov;
+        this->update_bin_tables();
+    }
+    this->hfov = depth_data->hfov;
+
+    this->roi_window(this->width, this->height, this->hfov, this->vfov,
+            this->x0, this->y0, this->x1, this->y1);
+
+    this->build_v_disparity(depth_buffer);
+    this->fit_ground();
+    this->build_u_disparity();
+    this->extract_obstacles();
+
+    return this->obstacles;
+}
+
+void DepthImageUVDisparityDetector::update_bin_tables()
+{
+    // Disparity is proportional to the inverse of the depth. Bins are spread
+    // evenly between the inverse of the maximum and minimum distances, so
+    // close obstacles get a finer depth resolution than far ones.
+    double inv_far = this->min_distance / this->threshold;
+    uint16_t min_raw = (uint16_t) glm::min(this->min_distance / this->scale,
+            (double) UINT16_MAX);
+    uint16_t max_raw = (uint16_t) glm::min(this->threshold / this->scale,
+            (double) UINT16_MAX);
+
+    this->depth_to_bin.resize(UINT16_MAX + 1);
+    for (unsigned int d = 0; d <= UINT16_MAX; d++) {
+        if (d == 0 || d > max_raw) {
+            this->depth_to_bin[d] = INVALID_BIN;
+        } else if (d <= min_raw) {
+            this->depth_to_bin[d] = this->num_bins;
+        } else {
+            double inv = this->min_distance / (d * this->scale);
+            double pos = (inv - inv_far) / (1.0 - inv_far) * (this->num_bins - 1);
+            this->depth_to_bin[d] = 1 + (uint8_t) (pos + 0.5);
+        }
+    }
+
+    // Depth represented by each bin and the minimum column height, in
+    // pixels, that an obstacle of 'min_obstacle_height' has at that depth
+    double focal_y = (this->height / 2.0) / tan(this->vfov / 2.0);
+
+    this->bin_depth.resize(this->num_bins + 1);
+    this->bin_min_height.resize(this->num_bins + 1);
+    for (unsigned int b = 1; b <= this->num_bins; b++) {
+        double inv = inv_far + (b - 1) * (1.0 - inv_far) / (this->num_bins - 1);
+        this->bin_depth[b] = this->min_distance / inv;
+        this->bin_min_height[b] = glm::max(defaults::min_column_pixels,
+                (unsigned int) (this->min_obstacle_height * focal_y / this->bin_depth[b]));
+    }
+
+    this->bins.resize(this->width * this->height);
+    this->v_disparity.resize(this->height * (this->num_bins + 1));
+    this->u_disparity.resize((this->num_bins + 1) * this->width);
+}
+
+void DepthImageUVDisparityDetector::build_v_disparity(
+        const std::vector<uint16_t> &depth_buffer)
+{
+    const uint8_t *lut = this->depth_to_bin.data();
+    unsigned int row_bins = this->num_bins + 1;
+
+    std::fill(this->v_disparity.begin(), this->v_disparity.end(), 0);
+
+    // Single streaming pass over the depth buffer: quantize every pixel and
+    // accumulate the V-disparity map. Invalid pixels land on bin 0, which is
+    // never read, so the inner loop has no branches.
+    for (unsigned int i = this->y0; i < this->y1; i++) {
+        const uint16_t *depth_row = &depth_buffer[i * this->width];
+        uint8_t *bin_row = &this->bins[i * this->width];
+        uint16_t *v_row = &this->v_disparity[i * row_bins];
+
+        for (unsigned int j = this->x0; j < this->x1; j++) {
+            bin_row[j] = lut[depth_row[j]];
+        }
+
+        for (unsigned int j = this->x0; j < this->x1; j++) {
+            v_row[bin_row[j]]++;
+        }
+    }
+}
+
+void DepthImageUVDisparityDetector::fit_ground()
+{
+    unsigned int row_bins = this->num_bins + 1;
+    unsigned int min_count = (this->x1 - this->x0) * defaults::ground_row_fraction;
+    std::vector<unsigned int> rows;
+    std::vector<unsigned int> ground_bins;
+
+    this->has_ground = false;
+
+    // The ground can only be seen on the lower half of the image. On each
+    // row, it is the dominant bin of the V-disparity map.
+    for (unsigned int i = glm::max(this->height / 2, this->y0); i < this->y1; i++) {
+        const uint16_t *v_row = &this->v_disparity[i * row_bins];
+        unsigned int best_bin = INVALID_BIN;
+        unsigned int best_count = min_count;
+
+        for (unsigned int b = 1; b <= this->num_bins; b++) {
+            if (v_row[b] >= best_count) {
+                best_bin = b;
+                best_count = v_row[b];
+            }
+        }
+
+        if (best_bin != INVALID_BIN) {
+            rows.push_back(i);
+            ground_bins.push_back(best_bin);
+        }
+    }
+
+    // Least squares line fit, repeated once without the outliers of the
+    // first fit
+    std::vector<bool> inlier(rows.size(), true);
+    for (int pass = 0; pass < 2; pass++) {
+        double n = 0, sr = 0, sb = 0, srr = 0, srb = 0;
+
+        for (size_t k = 0; k < rows.size(); k++) {
+            if (!inlier[k])
+                continue;
+
+            n += 1;
+            sr += rows[k];
+            sb += ground_bins[k];
+            srr += (double) rows[k] * rows[k];
+            srb += (double) rows[k] * ground_bins[k];
+        }
+
+        double det = n * srr - sr * sr;
+        if (n < defaults::min_ground_rows || det == 0) {
+            this->has_ground = false;
+            return;
+        }
+
+        this->ground_slope = (n * srb - sr * sb) / det;
+        this->ground_offset = (sb - this->ground_slope * sr) / n;
+
+        for (size_t k = 0; k < rows.size(); k++) {
+            double expected = this->ground_slope * rows[k] + this->ground_offset;
+            inlier[k] = fabs(ground_bins[k] - expected) <= this->ground_tolerance;
+        }
+    }
+
+    // The ground gets closer (higher disparity) towards the bottom of the image
+    this->has_ground = this->ground_slope > 0;
+}
+
+inline bool DepthImageUVDisparityDetector::is_ground(unsigned int row,
+        unsigned int bin)
+{
+    return this->has_ground &&
+        fabs(bin - (this->ground_slope * row + this->ground_offset)) <=
+        this->ground_tolerance;
+}
+
+void DepthImageUVDisparityDetector::build_u_disparity()
+{
+    std::fill(this->u_disparity.begin(), this->u_disparity.end(), 0);
+
+    for (unsigned int i = this->y0; i < this->y1; i++) {
+        const uint8_t *bin_row = &this->bins[i * this->width];
+
+        // Range of bins that belong to the ground on this row
+        int ground_min = 1;
+        int ground_max = 0;
+        if (this->has_ground) {
+            double g = this->ground_slope * i + this->ground_offset;
+            ground_min = (int) ceil(g - this->ground_tolerance);
+            ground_max = (int) floor(g + this->ground_tolerance);
+        }
+
+        // Ground pixels are redirected to the invalid bin
+        for (unsigned int j = this->x0; j < this->x1; j++) {
+            int b = bin_row[j];
+            b = (b >= ground_min && b <= ground_max) ? INVALID_BIN : b;
+            this->u_disparity[b * this->width + j]++;
+        }
+    }
+}
+
+double DepthImageUVDisparityDetector::segment_theta(const Segment &s)
+{
+    unsigned int row_bins = this->num_bins + 1;
+    double row_sum = 0;
+    double count = 0;
+
+    // Rows are not stored in the U-disparity map, so use the centroid of the
+    // non-ground pixels of the V-disparity map in the disparity range of
+    // the segment
+    for (unsigned int i = this->y0; i < this->y1; i++) {
+        const uint16_t *v_row = &this->v_disparity[i * row_bins];
+        for (unsigned int b = s.bin_far; b <= s.bin_near; b++) {
+            if (this->is_ground(i, b))
+                continue;
+
+            row_sum += (double) v_row[b] * i;
+            count += v_row[b];
+        }
+    }
+
+    return count ? row_sum / count : this->height / 2.0;
+}
+
+void DepthImageUVDisparityDetector::extract_obstacles()
+{
+    this->segments.clear();
+
+    // Scan the U-disparity map from the closest to the farthest bin looking
+    // for runs of columns tall enough to be an obstacle. Runs that overlap a
+    // segment found on the previous bin are merged into it.
+    for (unsigned int b = this->num_bins; b >= 1; b--) {
+        const uint16_t *u_row = &this->u_disparity[b * this->width];
+        unsigned int min_height = this->bin_min_height[b];
+        unsigned int j = this->x0;
+
+        while (j < this->x1) {
+            if (u_row[j] < min_height) {
+                j++;
+                continue;
+            }
+
+            Segment run = {j, j, b, b, b, 0, 0.0};
+            unsigned int gap = 0;
+
+            for (; j < this->x1 && gap <= this->max_col_gap; j++) {
+                if (u_row[j] < min_height) {
+                    gap++;
+                    continue;
+                }
+
+                gap = 0;
+                run.last_col = j;
+                run.num_pixels += u_row[j];
+                run.col_sum += (double) u_row[j] * j;
+            }
+
+            bool merged = false;
+            for (Segment &s : this->segments) {
+                if (s.last_bin > b + 1 || run.first_col > s.last_col ||
+                        run.last_col < s.first_col)
+                    continue;
+
+                s.first_col = glm::min(s.first_col, run.first_col);
+                s.last_col = glm::max(s.last_col, run.last_col);
+                s.bin_far = b;
+                s.last_bin = b;
+                s.num_pixels += run.num_pixels;
+                s.col_sum += run.col_sum;
+                merged = true;
+                break;
+            }
+
+            if (!merged) {
+                this->segments.push_back(run);
+            }
+        }
+    }
+
+    double base_phi = (M_PI - this->hfov) / 2;
+    double base_theta = (M_PI - this->vfov) / 2;
+
+    for (const Segment &s : this->segments) {
+        if (s.num_pixels < this->min_num_pixels)
+            continue;
+
+        double col = s.col_sum / s.num_pixels;
+        double row = this->segment_theta(s);
+
+        Obstacle o;
+        o.id = this->obstacles.size() + 1;
+        o.center.x = this->bin_depth[s.bin_near];
+        o.center.y = ((row / this->height) * this->vfov) + base_theta;
+        o.center.z = ((1.0 - (col / this->width)) * this->hfov) + base_phi;
+        this->obstacles.push_back(o);
+    }
+}
@@ -0,0 +1,102 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "detection/Detectors.hh"
+#include "sensors/Sensors.hh"
+
+/**
+ * Obstacle detector based on U-disparity and V-disparity histograms.
+ *
+ * Depth values are quantized into inverse depth ("disparity") bins. The
+ * V-disparity map (rows x bins) is used to fit the ground plane, which shows
+ * up as a line, and the U-disparity map (bins x columns) built from the
+ * remaining pixels is scanned for column segments that are tall enough to be
+ * an obstacle. Output follows DepthImageObstacleDetector: the radial
+ * component is the closest distance of the obstacle and the angles are the
+ * centroid of its pixels.
+ */
+class DepthImageUVDisparityDetector : public Detector
+{
+public:
+    DepthImageUVDisparityDetector(double threshold_meters = 5.0,
+            unsigned int num_bins = 128);
+    const std::vector<Obstacle> &detect(std::shared_ptr<void> data) override;
+
+private:
+    struct Segment {
+        unsigned int first_col;
+        unsigned int last_col;
+        unsigned int bin_near;
+        unsigned int bin_far;
+        unsigned int last_bin;
+        unsigned int num_pixels;
+        double col_sum;
+    };
+
+    std::vector<Obstacle> obstacles;
+    std::vector<Segment> segments;
+
+    // Disparity bin of each pixel, 0 means invalid
+    std::vector<uint8_t> bins;
+    std::vector<uint8_t> depth_to_bin;
+    std::vector<double> bin_depth;
+    std::vector<unsigned int> bin_min_height;
+
+    // V-disparity: height x (num_bins + 1), U-disparity: (num_bins + 1) x width
+    std::vector<uint16_t> v_disparity;
+    std::vector<uint16_t> u_disparity;
+
+    unsigned int width = 0;
+    unsigned int height = 0;
+
+    // Region of interest, [x0, x1) x [y0, y1)
+    unsigned int x0 = 0;
+    unsigned int y0 = 0;
+    unsigned int x1 = 0;
+    unsigned int y1 = 0;
+
+    double scale = 0;
+    double hfov = 0;
+    double vfov = 0;
+
+    // Ground line in the V-disparity map: bin = ground_slope * row + ground_offset
+    bool has_ground = false;
+    double ground_slope = 0;
+    double ground_offset = 0;
+
+    void update_bin_tables();
+    void build_v_disparity(const std::vector<uint16_t> &depth_buffer);
+    void fit_ground();
+    void build_u_disparity();
+    void extract_obstacles();
+    double segment_theta(const Segment &s);
+
+    bool is_ground(unsigned int row, unsigned int bin);
+
+    double threshold;
+    unsigned int num_bins;
+    double min_distance = 0.3;
+    double min_obstacle_height = 0.3;
+    unsigned int ground_tolerance = 2;
+    unsigned int min_num_pixels = 400; // same as DepthImageObstacleDetector
+    unsigned int max_col_gap = 2;
+};
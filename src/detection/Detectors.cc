@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2017 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "detection/Detectors.hh"
+#include "common/math.hh"
+
+DetectionRoi direction_roi(const glm::dvec3 &direction, double half_angle)
+{
+    DetectionRoi full = {0, M_PI, 0, M_PI};
+
+    if (glm::length(direction) == 0 || direction.y <= 0) {
+        return full;
+    }
+
+    PolarVector p = cartesian_to_spherical(direction.x, direction.y, direction.z);
+
+    return DetectionRoi{p.theta - half_angle, p.theta + half_angle,
+        p.phi - half_angle, p.phi + half_angle};
+}
+
+void Detector::set_roi(const DetectionRoi &roi)
+{
+    this->roi = roi;
+    this->has_roi = true;
+}
+
+void Detector::clear_roi()
+{
+    this->has_roi = false;
+}
+
+const DetectorStats &Detector::get_stats()
+{
+    return this->stats;
+}
+
+void Detector::roi_window(unsigned int width, unsigned int height,
+        double hfov, double vfov, unsigned int &x0, unsigned int &y0,
+        unsigned int &x1, unsigned int &y1)
+{
+    x0 = 0;
+    y0 = 0;
+    x1 = width;
+    y1 = height;
+
+    if (this->has_roi && hfov > 0 && vfov > 0) {
+        // Inverse of the pixel to angle mapping used by the detectors:
+        // theta grows from top to bottom and phi from right to left
+        double base_phi = (M_PI - hfov) / 2;
+        double base_theta = (M_PI - vfov) / 2;
+
+        double col_min = (1.0 - (this->roi.phi_max - base_phi) / hfov) * width;
+        double col_max = (1.0 - (this->roi.phi_min - base_phi) / hfov) * width;
+        double row_min = (this->roi.theta_min - base_theta) / vfov * height;
+        double row_max = (this->roi.theta_max - base_theta) / vfov * height;
+
+        x0 = (unsigned int) glm::clamp(floor(col_min), 0.0, (double) width);
+        x1 = (unsigned int) glm::clamp(ceil(col_max), 0.0, (double) width);
+        y0 = (unsigned int) glm::clamp(floor(row_min), 0.0, (double) height);
+        y1 = (unsigned int) glm::clamp(ceil(row_max), 0.0, (double) height);
+
+        x1 = glm::max(x0, x1);
+        y1 = glm::max(y0, y1);
+    }
+
+    unsigned long processed = (x1 - x0) * (y1 - y0);
+    this->stats.frames++;
+    this->stats.pixels_processed += processed;
+    this->stats.pixels_skipped += (unsigned long) width * height - processed;
+}
@@ -16,13 +16,63 @@
 
 #pragma once
 
+#include <cmath>
 #include <memory>
 #include <vector>
 
 #include "common/common.hh"
 
+/**
+ * Region of interest of a detector, as an angular window in the sensor
+ * spherical coordinates used by Obstacle (theta: polar, phi: azimuthal).
+ */
+struct DetectionRoi {
+    double theta_min;
+    double theta_max;
+    double phi_min;
+    double phi_max;
+};
+
+/**
+ * @brief Region of interest around a direction of flight.
+ *
+ * @param direction Direction in the sensor frame (x right, y forward, z up).
+ * A null direction, or one that points behind the sensor, covers everything.
+ * @param half_angle Half angle of the cone around the direction, in radians.
+ */
+DetectionRoi direction_roi(const glm::dvec3 &direction, double half_angle);
+
+struct DetectorStats {
+    unsigned long frames;
+    unsigned long pixels_processed;
+    unsigned long pixels_skipped;
+};
+
 class Detector
 {
 public:
     virtual const std::vector<Obstacle> &detect(std::shared_ptr<void> data) = 0;
+
+    /**
+     * @brief Restrict detection to a region of interest. Pixels outside of
+     * it are not processed.
+     */
+    void set_roi(const DetectionRoi &roi);
+    void clear_roi();
+
+    const DetectorStats &get_stats();
+
+protected:
+    bool has_roi = false;
+    DetectionRoi roi = {0, M_PI, 0, M_PI};
+    DetectorStats stats = {0, 0, 0};
+
+    /**
+     * @brief Pixel window [x0, x1) x [y0, y1) covered by the region of
+     * interest on an image with the given dimensions and field of view. It
+     * also accounts for the frame on the detector statistics.
+     */
+    void roi_window(unsigned int width, unsigned int height, double hfov,
+            double vfov, unsigned int &x0, unsigned int &y0, unsigned int &x1,
+            unsigned int &y1);
 };
@@ -15,9 +15,12 @@
 */
 
 #include "Sensors.hh"
+#include "common/latency.hh"
 
 #include <cmath>
 
+static LatencyHistogram read_latency("sensor.read");
+
 unsigned int DepthCamera::get_height()
 {
     return height;
@@ -35,6 +38,7 @@ double DepthCamera::get_scale()
 
 std::shared_ptr<struct DepthData> DepthCamera::read()
 {
+    ScopedLatency timer(read_latency);
     std::shared_ptr<struct DepthData> data = std::make_shared<struct DepthData>();
 
     data->height = this->get_height();
@@ -43,6 +47,7 @@ std::shared_ptr<struct DepthData> DepthCamera::read()
     data->hfov = this->get_horizontal_fov();
     data->vfov = this->get_vertical_fov();
     data->depth_buffer = this->get_depth_buffer();
+    data->timestamp = std::chrono::steady_clock::now();
 
     return data;
 }
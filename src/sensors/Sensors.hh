@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <vector>
@@ -27,6 +28,7 @@ struct DepthData
     double scale;
     double hfov;
     double vfov;
+    std::chrono::steady_clock::time_point timestamp;
     std::vector<uint16_t> depth_buffer;
 };
 
@@ -0,0 +1,173 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "common/math.hh"
+#include "sensors/SimulatedDepthCamera.hh"
+
+bool load_sim_world(const std::string &path, std::vector<SimPillar> &pillars)
+{
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "[SimulatedDepthCamera] Could not open world file "
+                  << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    unsigned int line_number = 0;
+
+    while (std::getline(file, line)) {
+        line_number++;
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind)) {
+            continue;
+        }
+
+        SimPillar p;
+        if (kind != "pillar" ||
+                !(fields >> p.x >> p.y >> p.radius >> p.height) ||
+                p.radius <= 0 || p.height <= 0) {
+            std::cerr << "[SimulatedDepthCamera] Invalid world line "
+                      << line_number << ": " << line << std::endl;
+            return false;
+        }
+
+        pillars.push_back(p);
+    }
+
+    return true;
+}
+
+SimulatedDepthCamera::SimulatedDepthCamera(std::function<Pose()> pose_source,
+        const std::vector<SimPillar> &pillars, unsigned int width,
+        unsigned int height, unsigned int fps)
+{
+    this->pose_source = pose_source;
+    this->pillars = pillars;
+
+    this->width = width;
+    this->height = height;
+    this->scale = 0.001;
+    this->hfov = glm::radians(59.0);
+    this->vfov = glm::radians(46.0);
+
+    this->depth_buffer.resize(width * height);
+    this->frame_period = fps ?
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / fps)) :
+        std::chrono::steady_clock::duration::zero();
+    this->next_frame = std::chrono::steady_clock::now();
+}
+
+std::vector<uint16_t> &SimulatedDepthCamera::get_depth_buffer()
+{
+    using namespace std::chrono;
+
+    if (this->frame_period > steady_clock::duration::zero()) {
+        std::this_thread::sleep_until(this->next_frame);
+
+        // Do not try to catch up on frames that were not read in time
+        steady_clock::time_point now = steady_clock::now();
+        this->next_frame = glm::max(this->next_frame + this->frame_period, now);
+    }
+
+    this->render(this->pose_source());
+
+    return this->depth_buffer;
+}
+
+void SimulatedDepthCamera::render(Pose pose)
+{
+    struct Hit {
+        double depth;
+        double height;
+    };
+
+    double yaw = pose.yaw();
+    double fx = (this->width / 2.0) / tan(this->hfov / 2.0);
+    double fy = (this->height / 2.0) / tan(this->vfov / 2.0);
+    std::vector<Hit> hits;
+
+    for (unsigned int j = 0; j < this->width; j++) {
+        // Horizontal direction of the column, scaled so its forward
+        // component is one: the distance along it is the depth
+        double right = (j + 0.5 - this->width / 2.0) / fx;
+        glm::dvec3 dir = rotate_z(glm::dvec3(right, 1.0, 0.0), yaw);
+
+        // Pillars crossed by the column, closest first
+        hits.clear();
+        for (const SimPillar &p : this->pillars) {
+            double ox = pose.pos.x - p.x;
+            double oy = pose.pos.y - p.y;
+            double a = dir.x * dir.x + dir.y * dir.y;
+            double b = 2.0 * (ox * dir.x + oy * dir.y);
+            double c = ox * ox + oy * oy - p.radius * p.radius;
+            double disc = b * b - 4.0 * a * c;
+
+            if (disc < 0) {
+                continue;
+            }
+
+            double far = (-b + sqrt(disc)) / (2.0 * a);
+            double near = glm::max((-b - sqrt(disc)) / (2.0 * a), 0.0);
+            if (far <= 0 || near > this->max_range) {
+                continue;
+            }
+
+            hits.push_back(Hit{near, p.height});
+        }
+
+        std::sort(hits.begin(), hits.end(), [](const Hit &a, const Hit &b) {
+            return a.depth < b.depth;
+        });
+
+        for (unsigned int i = 0; i < this->height; i++) {
+            // Height gained per meter of depth along the row
+            double up = -(i + 0.5 - this->height / 2.0) / fy;
+            double depth = 0;
+
+            if (up < 0 && pose.pos.z > 0) {
+                depth = -pose.pos.z / up;
+                depth = depth <= this->max_range ? depth : 0;
+            }
+
+            for (const Hit &h : hits) {
+                if (depth && h.depth >= depth) {
+                    break;
+                }
+
+                double z = pose.pos.z + h.depth * up;
+                if (z >= 0 && z <= h.height) {
+                    depth = h.depth;
+                    break;
+                }
+            }
+
+            this->depth_buffer[i * this->width + j] = (uint16_t) glm::min(
+                    depth / this->scale, (double) UINT16_MAX);
+        }
+    }
+}
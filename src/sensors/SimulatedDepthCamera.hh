@@ -0,0 +1,76 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "common/common.hh"
+#include "sensors/Sensors.hh"
+
+/**
+ * Vertical cylinder standing on the ground, in local ENU coordinates
+ * relative to the home position, in meters.
+ */
+struct SimPillar {
+    double x;
+    double y;
+    double radius;
+    double height;
+};
+
+/**
+ * @brief Read a world description. Each non-empty line that is not a
+ * comment (#) is "pillar <x> <y> <radius> <height>".
+ *
+ * @return false if the file can not be read or has invalid lines.
+ */
+bool load_sim_world(const std::string &path, std::vector<SimPillar> &pillars);
+
+/**
+ * Depth camera that renders a world of pillars over a flat ground.
+ *
+ * The camera is level, looks along the vehicle heading and is placed at the
+ * pose given by 'pose_source', usually the vehicle pose. Frames are paced
+ * to the frame rate, as a real camera would. With a frame rate of 0, a frame
+ * is rendered on every call, for callers that do their own pacing.
+ */
+class SimulatedDepthCamera : public DepthCamera
+{
+public:
+    SimulatedDepthCamera(std::function<Pose()> pose_source,
+            const std::vector<SimPillar> &pillars, unsigned int width = 320,
+            unsigned int height = 240, unsigned int fps = 30);
+
+    std::vector<uint16_t> &get_depth_buffer() override;
+
+private:
+    std::function<Pose()> pose_source;
+    std::vector<SimPillar> pillars;
+    std::vector<uint16_t> depth_buffer;
+
+    std::chrono::steady_clock::duration frame_period;
+    std::chrono::steady_clock::time_point next_frame;
+
+    // Same range as the RealSense R200
+    double max_range = 10.0;
+
+    void render(Pose pose);
+};
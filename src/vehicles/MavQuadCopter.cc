@@ -15,17 +15,122 @@
 */
 
 #include "MavQuadCopter.hh"
+#include "common/latency.hh"
+#include "common/math.hh"
+#include "common/realtime.hh"
 
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
 #include <cstdint>
+#include <ctime>
 #include <fcntl.h>
 #include <iostream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
+#include <sys/timerfd.h>
 #include <unistd.h>
 
 namespace defaults
 {
 const uint16_t local_port = 15557;
+// Rate at which the vehicle state is updated when no message arrives, so
+// mav_vehicle can handle its timeouts
+const double tick_rate_hz = 50.0;
+// Packet ring: datagrams drained per recvmmsg call and their maximum size
+const unsigned int rx_batch_size = 32;
+const size_t rx_packet_len = 2048;
+// Window over which the CPU usage of the run thread is measured
+const double cpu_usage_window_sec = 2.0;
 const double wp_equal_dist_m = 0.001;
+// Offset used to linearize the global conversion around home, in meters.
+// Long enough for the integer coordinates not to limit precision.
+const double frame_step_m = 1000.0;
+// Below this speed, in m/s, the vehicle is considered to be hovering
+const double min_flight_speed = 0.3;
+// Weight of the newest sample on the velocity low pass filter
+const double velocity_filter = 0.5;
+// Position samples further apart than this, in seconds, are not used
+const double max_position_interval = 0.5;
+// Velocity setpoint streaming
+const double velocity_rate_hz = 40.0;
+const double velocity_timeout_sec = 0.5;
+const uint8_t sysid = 1;
+const uint8_t compid = MAV_COMP_ID_PATHPLANNER;
+const uint8_t target_sysid = 1;
+const uint8_t target_compid = 1;
+// Use velocity and yaw rate, ignore position, acceleration and yaw
+const uint16_t velocity_type_mask = 0x05C7;
+}
+
+// Shared by all vehicles of the process
+static LatencyHistogram tx_latency("mavlink.send");
+static LatencyHistogram rx_latency("mavlink.receive");
+
+static bool same_position(const mavlink_vehicles::global_pos_int &a,
+                          const mavlink_vehicles::global_pos_int &b)
+{
+    return a.lat == b.lat && a.lon == b.lon && a.alt == b.alt;
+}
+
+static glm::dvec3 global_diff(const mavlink_vehicles::global_pos_int &a,
+                              const mavlink_vehicles::global_pos_int &b)
+{
+    return glm::dvec3((double) a.lat - b.lat, (double) a.lon - b.lon,
+                      (double) a.alt - b.alt);
+}
+
+void LocalFrame::update(const mavlink_vehicles::global_pos_int &home)
+{
+    using mavlink_vehicles::local_pos;
+    using mavlink_vehicles::math::local_ned_to_global;
+
+    // Central differences, so the curvature terms cancel out
+    double step = defaults::frame_step_m;
+
+    this->home = home;
+    this->north = global_diff(local_ned_to_global(local_pos(step, 0, 0), home),
+                              local_ned_to_global(local_pos(-step, 0, 0), home)) /
+                  (2 * step);
+    this->east = global_diff(local_ned_to_global(local_pos(0, step, 0), home),
+                             local_ned_to_global(local_pos(0, -step, 0), home)) /
+                 (2 * step);
+    this->down = global_diff(local_ned_to_global(local_pos(0, 0, step), home),
+                             local_ned_to_global(local_pos(0, 0, -step), home)) /
+                 (2 * step);
+    this->valid = true;
+}
+
+mavlink_vehicles::global_pos_int
+LocalFrame::to_global(const mavlink_vehicles::local_pos &pos) const
+{
+    glm::dvec3 offset = this->north * pos.x + this->east * pos.y +
+                        this->down * pos.z;
+
+    return mavlink_vehicles::global_pos_int(
+        this->home.lat + (int32_t) round(offset.x),
+        this->home.lon + (int32_t) round(offset.y),
+        this->home.alt + (int32_t) round(offset.z));
+}
+
+Pose mission_target_pose(const mavlink_vehicles::global_pos_int &waypoint,
+                         const mavlink_vehicles::global_pos_int &home)
+{
+    mavlink_vehicles::local_pos pos_ned =
+        mavlink_vehicles::math::global_to_local_ned(waypoint, home);
+
+    // Convert position from NED to ENU, like the vehicle pose
+    Pose target;
+    target.pos.x = pos_ned.y;
+    target.pos.y = pos_ned.x;
+    target.pos.z = -pos_ned.z;
+    target.rot.x = 0;
+    target.rot.y = 0;
+    target.rot.z = 0;
+    target.rot.w = 0;
+
+    return target;
 }
 
 MavQuadCopter::MavQuadCopter() : MavQuadCopter(defaults::local_port)
@@ -63,6 +168,45 @@ MavQuadCopter::MavQuadCopter(uint16_t local_port)
     this->mav = std::make_shared<mavlink_vehicles::mav_vehicle>(sock);
     std::cout << "[MavQuadCopter] mavlink_vehicle instantiated" << std::endl;
 
+    // Event loop: socket, periodic tick, velocity setpoint timer and wakeup
+    // on destruction
+    this->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    this->tick_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    this->velocity_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    this->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (this->epoll_fd < 0 || this->tick_fd < 0 || this->velocity_fd < 0 ||
+        this->wakeup_fd < 0) {
+        perror("[MavQuadCopter] error creating event loop");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int fd : {this->sock, this->tick_fd, this->velocity_fd, this->wakeup_fd}) {
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+
+        if (epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            perror("[MavQuadCopter] error adding to event loop");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    this->set_timer(this->tick_fd, 1.0 / defaults::tick_rate_hz);
+
+    // Packet ring, each slot points to its own part of the buffer
+    this->rx_buffer.resize(defaults::rx_batch_size * defaults::rx_packet_len);
+    this->rx_iov.resize(defaults::rx_batch_size);
+    this->rx_msgs.resize(defaults::rx_batch_size);
+
+    for (unsigned int i = 0; i < defaults::rx_batch_size; i++) {
+        this->rx_iov[i].iov_base = &this->rx_buffer[i * defaults::rx_packet_len];
+        this->rx_iov[i].iov_len = defaults::rx_packet_len;
+        this->rx_msgs[i] = {};
+        this->rx_msgs[i].msg_hdr.msg_iov = &this->rx_iov[i];
+        this->rx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
     // Initialize mav_vehicle update thread
     this->thread_run = true;
     this->thread = std::thread(&MavQuadCopter::run, this);
@@ -71,130 +215,326 @@ MavQuadCopter::MavQuadCopter(uint16_t local_port)
 MavQuadCopter::~MavQuadCopter()
 {
     this->thread_run = false;
+
+    // Wake the run thread up so it sees the flag
+    uint64_t one = 1;
+    if (write(this->wakeup_fd, &one, sizeof(one)) < 0) {
+        perror("[MavQuadCopter] error waking up run thread");
+    }
+
+    if (this->thread.joinable()) {
+        this->thread.join();
+    }
+
+    close(this->epoll_fd);
+    close(this->tick_fd);
+    close(this->velocity_fd);
+    close(this->wakeup_fd);
 }
 
-void MavQuadCopter::run()
+void MavQuadCopter::set_timer(int fd, double period_sec)
 {
-    while (this->thread_run) {
+    // A zero period disarms the timer, otherwise it first expires right away
+    struct itimerspec spec = {};
 
-        // Update vehicle state
-        this->mav->update();
+    if (period_sec > 0) {
+        spec.it_interval.tv_sec = (time_t) period_sec;
+        spec.it_interval.tv_nsec = (long) ((period_sec - spec.it_interval.tv_sec) * 1e9);
+        spec.it_value.tv_nsec = 1;
+    }
 
-        // Check if vehicle is ready
-        if (!this->mav->is_ready()) {
-            continue;
-        }
+    if (timerfd_settime(fd, 0, &spec, nullptr) < 0) {
+        perror("[MavQuadCopter] error setting timer");
+    }
+}
 
-        mavlink_vehicles::arm_status arm_stat = this->mav->get_arm_status();
-        mavlink_vehicles::status status = this->mav->get_status();
-        mavlink_vehicles::mode mode = this->mav->get_mode();
+static bool consume_event(int fd)
+{
+    // Timers and eventfds stay readable until their counter is read
+    uint64_t count;
+    return read(fd, &count, sizeof(count)) == sizeof(count);
+}
 
-        switch (this->vehicle_state) {
-        case INIT: {
+void MavQuadCopter::run()
+{
+    const int max_events = 4;
+    struct epoll_event events[max_events];
 
-            if (status == mavlink_vehicles::status::STANDBY) {
-                this->vehicle_state = INIT_ON_GROUND;
-            } else if (status == mavlink_vehicles::status::ACTIVE) {
-                this->vehicle_state = ACTIVE_AIRBORNE;
+    while (this->thread_run) {
+        int n = epoll_wait(this->epoll_fd, events, max_events, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
             }
-
-            continue;
+            perror("[MavQuadCopter] error waiting for events");
+            break;
         }
-        case INIT_ON_GROUND: {
 
-            if (!this->autotakeoff) {
-                this->vehicle_state = ACTIVE_ON_GROUND;
-                continue;
+        bool update = false;
+        bool poll_mav = false;
+
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+
+            if (fd == this->sock) {
+                // mav_vehicle learns the autopilot address from the first
+                // datagram, so that one is left to it
+                if (this->batch_rx) {
+                    this->receive_batch();
+                } else {
+                    poll_mav = true;
+                    this->batch_rx = true;
+                }
+                update = true;
+            } else if (fd == this->tick_fd) {
+                if (consume_event(fd)) {
+                    // Lets mav_vehicle handle its timeouts
+                    poll_mav = true;
+                    update = true;
+                    this->update_cpu_usage();
+                }
+            } else if (fd == this->velocity_fd) {
+                if (consume_event(fd)) {
+                    this->send_velocity_setpoint();
+                }
+            } else if (fd == this->wakeup_fd) {
+                consume_event(fd);
             }
+        }
 
-            // Execute takeoff procedures
-            if (mode != mavlink_vehicles::mode::GUIDED) {
-                this->mav->set_mode(mavlink_vehicles::mode::GUIDED);
-                continue;
-            }
+        if (poll_mav) {
+            this->mav->update();
+        }
 
-            if (arm_stat != mavlink_vehicles::arm_status::ARMED) {
-                this->mav->arm_throttle();
-                continue;
-            }
+        if (update) {
+            this->update_state();
+            this->publish_state();
+        }
+    }
+}
 
-            if (status != mavlink_vehicles::status::ACTIVE) {
-                this->mav->takeoff();
-                continue;
-            }
+void MavQuadCopter::update_state()
+{
+    // Check if vehicle is ready
+    if (!this->mav->is_ready()) {
+        return;
+    }
+
+    this->update_velocity();
+
+    mavlink_vehicles::arm_status arm_stat = this->mav->get_arm_status();
+    mavlink_vehicles::status status = this->mav->get_status();
+    mavlink_vehicles::mode mode = this->mav->get_mode();
 
-            // Takeoff succeeded
+    switch (this->vehicle_state) {
+    case INIT: {
+
+        if (status == mavlink_vehicles::status::STANDBY) {
+            this->vehicle_state = INIT_ON_GROUND;
+        } else if (status == mavlink_vehicles::status::ACTIVE) {
             this->vehicle_state = ACTIVE_AIRBORNE;
-            continue;
         }
-        case ACTIVE_ON_GROUND: {
 
-            if (status == mavlink_vehicles::status::ACTIVE) {
-                this->vehicle_state = ACTIVE_AIRBORNE;
-            }
+        return;
+    }
+    case INIT_ON_GROUND: {
 
-            continue;
+        if (!this->autotakeoff) {
+            this->vehicle_state = ACTIVE_ON_GROUND;
+            return;
         }
-        case ACTIVE_AIRBORNE: {
 
-            continue;
+        // Execute takeoff procedures
+        if (mode != mavlink_vehicles::mode::GUIDED) {
+            this->mav->set_mode(mavlink_vehicles::mode::GUIDED);
+            return;
         }
+
+        if (arm_stat != mavlink_vehicles::arm_status::ARMED) {
+            this->mav->arm_throttle();
+            return;
+        }
+
+        if (status != mavlink_vehicles::status::ACTIVE) {
+            this->mav->takeoff();
+            return;
         }
+
+        // Takeoff succeeded
+        this->vehicle_state = ACTIVE_AIRBORNE;
+        return;
+    }
+    case ACTIVE_ON_GROUND: {
+
+        if (status == mavlink_vehicles::status::ACTIVE) {
+            this->vehicle_state = ACTIVE_AIRBORNE;
+        }
+
+        return;
+    }
+    case ACTIVE_AIRBORNE: {
+
+        return;
+    }
     }
 }
 
-Pose MavQuadCopter::target_pose()
+void MavQuadCopter::update_velocity()
 {
-    using namespace mavlink_vehicles;
+    using namespace std::chrono;
+
+    mavlink_vehicles::local_pos pos = this->mav->get_local_position_ned();
+    steady_clock::time_point now = steady_clock::now();
+    double dt = duration<double>(now - this->last_pos_time).count();
 
-    // Convert from global_pos_int to local_pos_enu and return
-    local_pos target_pos_ned = mavlink_vehicles::math::global_to_local_ned(
-        this->mav->get_mission_waypoint(), this->mav->get_home_position_int());
+    bool new_sample = pos.x != this->last_pos.x || pos.y != this->last_pos.y ||
+        pos.z != this->last_pos.z;
 
-    Pose target_pose;
-    target_pose.pos.x = target_pos_ned.x;
-    target_pose.pos.y = target_pos_ned.y;
-    target_pose.pos.z = -target_pos_ned.z;
-    target_pose.rot.x = 0;
-    target_pose.rot.y = 0;
-    target_pose.rot.z = 0;
-    target_pose.rot.w = 0;
+    if (!new_sample) {
+        // The position stopped changing, the vehicle is not moving
+        if (dt > defaults::max_position_interval) {
+            this->velocity = glm::dvec3(0, 0, 0);
+        }
+        return;
+    }
+
+    if (dt > 0 && dt <= defaults::max_position_interval) {
+        // Convert from NED to ENU
+        glm::dvec3 sample((pos.y - this->last_pos.y) / dt,
+                          (pos.x - this->last_pos.x) / dt,
+                          -(pos.z - this->last_pos.z) / dt);
+
+        this->velocity = glm::mix(this->velocity, sample, defaults::velocity_filter);
+    }
 
-    return target_pose;
+    this->last_pos = pos;
+    this->last_pos_time = now;
 }
 
-Pose MavQuadCopter::vehicle_pose()
+void MavQuadCopter::publish_state()
 {
     using namespace mavlink_vehicles;
 
-    // Convert from global_pos_int to local_pos_enu and return
+    VehicleState state;
+    state.timestamp = std::chrono::steady_clock::now();
+    state.ready = this->mav->is_ready();
+    state.mode = this->mav->get_mode();
+    state.home = this->mav->get_home_position_int();
+    state.mission_waypoint = this->mav->get_mission_waypoint();
+    state.velocity = this->velocity;
+
+    // Geodetic conversions are only redone when home or the mission
+    // waypoint change, which is rare
+    VehicleState previous = this->state.load();
+
+    if (previous.frame.valid && same_position(state.home, previous.frame.home)) {
+        state.frame = previous.frame;
+    } else {
+        state.frame.update(state.home);
+    }
+
+    if (previous.frame.valid && same_position(state.home, previous.home) &&
+        same_position(state.mission_waypoint, previous.mission_waypoint)) {
+        state.target = previous.target;
+    } else {
+        state.target = mission_target_pose(state.mission_waypoint, state.home);
+    }
+
     local_pos vehicle_pos_ned = this->mav->get_local_position_ned();
     attitude vehicle_att = this->mav->get_attitude();
-    Pose vehicle_pose;
 
     // Convert position from NED to ENU and set
-    vehicle_pose.pos.x = vehicle_pos_ned.y;
-    vehicle_pose.pos.y = vehicle_pos_ned.x;
-    vehicle_pose.pos.z = -vehicle_pos_ned.z;
+    state.pose.pos.x = vehicle_pos_ned.y;
+    state.pose.pos.y = vehicle_pos_ned.x;
+    state.pose.pos.z = -vehicle_pos_ned.z;
 
     // Converting rotation from NED to ENU
     std::swap(vehicle_att.roll, vehicle_att.pitch);
     vehicle_att.yaw = -vehicle_att.yaw;
 
     // Set rotation
-    vehicle_pose.set_rot(vehicle_att.roll, vehicle_att.pitch, vehicle_att.yaw);
+    state.pose.set_rot(vehicle_att.roll, vehicle_att.pitch, vehicle_att.yaw);
+
+    // Only actual changes go to the history, so it spans as long as possible
+    if (state.pose.pos != previous.pose.pos || state.pose.rot != previous.pose.rot) {
+        std::lock_guard<std::mutex> locker(this->pose_history_mtx);
+        this->pose_history.push(state.timestamp, state.pose);
+    }
+
+    this->state.store(state);
+}
 
-    return vehicle_pose;
+VehicleState MavQuadCopter::get_state()
+{
+    return this->state.load();
+}
+
+glm::dvec3 MavQuadCopter::vehicle_velocity()
+{
+    return this->state.load().velocity;
+}
+
+glm::dvec3 flight_direction(const VehicleState &state)
+{
+    if (!state.ready) {
+        return glm::dvec3(0, 0, 0);
+    }
+
+    Pose pose = state.pose;
+    glm::dvec3 direction = state.velocity;
+
+    if (glm::length(direction) < defaults::min_flight_speed) {
+        direction = state.target.pos - pose.pos;
+    }
+
+    if (glm::length(direction) < defaults::wp_equal_dist_m) {
+        return glm::dvec3(0, 0, 0);
+    }
+
+    // Rotate from the local frame to the vehicle frame
+    return rotate_z(direction, -pose.yaw());
+}
+
+glm::dvec3 MavQuadCopter::flight_direction()
+{
+    return ::flight_direction(this->state.load());
+}
+
+Pose MavQuadCopter::target_pose()
+{
+    return this->state.load().target;
+}
+
+Pose MavQuadCopter::vehicle_pose()
+{
+    return this->state.load().pose;
+}
+
+Pose MavQuadCopter::vehicle_pose_at(std::chrono::steady_clock::time_point time)
+{
+    Pose pose;
+
+    {
+        std::lock_guard<std::mutex> locker(this->pose_history_mtx);
+        if (this->pose_history.lookup(time, pose)) {
+            return pose;
+        }
+    }
+
+    return this->vehicle_pose();
 }
 
 void MavQuadCopter::set_target_pose(Pose pose)
 {
+    VehicleState state = this->state.load();
+    mavlink_vehicles::local_pos pos_ned(pose.pos.y, pose.pos.x, -pose.pos.z);
+
     // Convert from local coordinates to global coordinates
-    mavlink_vehicles::global_pos_int global_coord =
-        mavlink_vehicles::math::local_ned_to_global(
-            mavlink_vehicles::local_pos(pose.pos.y, pose.pos.x, -pose.pos.z),
-            this->mav->get_home_position_int());
+    mavlink_vehicles::global_pos_int global_coord = state.frame.valid ?
+        state.frame.to_global(pos_ned) :
+        mavlink_vehicles::math::local_ned_to_global(pos_ned, state.home);
 
+    ScopedLatency timer(tx_latency);
     this->mav->send_detour_waypoint(global_coord);
 }
 
@@ -205,6 +545,239 @@ void MavQuadCopter::rotate(double angle_deg)
 
 bool MavQuadCopter::detour_finished()
 {
-    return this->mav->get_mode() == mavlink_vehicles::mode::AUTO;
+    return this->state.load().mode == mavlink_vehicles::mode::AUTO;
+}
+
+void MavQuadCopter::set_target_velocity(const glm::dvec3 &velocity,
+                                        double yaw_rate)
+{
+    bool was_active;
+
+    {
+        std::lock_guard<std::mutex> locker(this->velocity_sp_mtx);
+        was_active = this->velocity_sp_active;
+        this->velocity_sp = velocity;
+        this->yaw_rate_sp = yaw_rate;
+        this->velocity_sp_time = std::chrono::steady_clock::now();
+        this->velocity_sp_active = true;
+    }
+
+    if (!was_active) {
+        // Velocity setpoints are only followed in GUIDED mode
+        this->mav->set_mode(mavlink_vehicles::mode::GUIDED);
+        this->set_timer(this->velocity_fd, 1.0 / defaults::velocity_rate_hz);
+    }
+}
+
+void MavQuadCopter::stop_target_velocity()
+{
+    {
+        std::lock_guard<std::mutex> locker(this->velocity_sp_mtx);
+        if (!this->velocity_sp_active) {
+            return;
+        }
+        this->velocity_sp_active = false;
+    }
+
+    this->set_timer(this->velocity_fd, 0);
+    this->mav->set_mode(mavlink_vehicles::mode::AUTO);
+}
+
+bool MavQuadCopter::is_velocity_streaming()
+{
+    std::lock_guard<std::mutex> locker(this->velocity_sp_mtx);
+    return this->velocity_sp_active;
+}
+
+void MavQuadCopter::send_velocity(const glm::dvec3 &velocity, double yaw_rate)
+{
+    using namespace std::chrono;
+
+    uint32_t time_boot_ms = duration_cast<milliseconds>(
+        steady_clock::now().time_since_epoch()).count();
+
+    // Convert from ENU to NED
+    mavlink_message_t msg;
+    mavlink_msg_set_position_target_local_ned_pack(
+        defaults::sysid, defaults::compid, &msg, time_boot_ms,
+        defaults::target_sysid, defaults::target_compid, MAV_FRAME_LOCAL_NED,
+        defaults::velocity_type_mask, 0, 0, 0, velocity.y, velocity.x,
+        -velocity.z, 0, 0, 0, 0, -yaw_rate);
+
+    ScopedLatency timer(tx_latency);
+    this->mav->send_mavlink_msg(&msg);
+}
+
+void MavQuadCopter::send_obstacle_distance(
+    mavlink_obstacle_distance_t &obstacle_distance)
+{
+    using namespace std::chrono;
+
+    obstacle_distance.time_usec = duration_cast<microseconds>(
+        steady_clock::now().time_since_epoch()).count();
+
+    mavlink_message_t msg;
+    mavlink_msg_obstacle_distance_encode(defaults::sysid, defaults::compid,
+                                         &msg, &obstacle_distance);
+
+    ScopedLatency timer(tx_latency);
+    this->mav->send_mavlink_msg(&msg);
+}
+
+void MavQuadCopter::send_velocity_setpoint()
+{
+    using namespace std::chrono;
+
+    glm::dvec3 velocity;
+    double yaw_rate;
+
+    {
+        std::lock_guard<std::mutex> locker(this->velocity_sp_mtx);
+        if (!this->velocity_sp_active) {
+            return;
+        }
+
+        velocity = this->velocity_sp;
+        yaw_rate = this->yaw_rate_sp;
+
+        // The caller stopped updating the setpoint, hold position
+        if (steady_clock::now() - this->velocity_sp_time >
+                duration<double>(defaults::velocity_timeout_sec)) {
+            velocity = glm::dvec3(0, 0, 0);
+            yaw_rate = 0;
+        }
+    }
+
+    this->send_velocity(velocity, yaw_rate);
+}
+
+void MavQuadCopter::update_cpu_usage()
+{
+    using namespace std::chrono;
+
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) < 0) {
+        return;
+    }
+
+    double cpu = ts.tv_sec + ts.tv_nsec * 1e-9;
+    steady_clock::time_point now = steady_clock::now();
+    double elapsed = duration<double>(now - this->cpu_sample_time).count();
+
+    if (this->cpu_sample_time == steady_clock::time_point()) {
+        this->cpu_sample = cpu;
+        this->cpu_sample_time = now;
+        return;
+    }
+
+    if (elapsed < defaults::cpu_usage_window_sec) {
+        return;
+    }
+
+    this->cpu_usage = (cpu - this->cpu_sample) / elapsed;
+    this->cpu_sample = cpu;
+    this->cpu_sample_time = now;
+}
+
+double MavQuadCopter::io_cpu_usage()
+{
+    return this->cpu_usage;
+}
+
+bool MavQuadCopter::parse_char(uint8_t c, mavlink_message_t &msg)
+{
+    mavlink_status_t status;
+    uint8_t result = mavlink_frame_char_buffer(&this->rx_parse_msg,
+            &this->rx_parse_status, c, &msg, &status);
+
+    // Same recovery as mavlink_parse_char(): a corrupted frame is dropped
+    // and parsing restarts, at this byte if it starts a new frame
+    if (result == MAVLINK_FRAMING_BAD_CRC ||
+            result == MAVLINK_FRAMING_BAD_SIGNATURE) {
+        this->rx_parse_status.parse_error++;
+        this->rx_parse_status.msg_received = MAVLINK_FRAMING_INCOMPLETE;
+        this->rx_parse_status.parse_state = MAVLINK_PARSE_STATE_IDLE;
+
+        if (c == MAVLINK_STX) {
+            this->rx_parse_status.parse_state = MAVLINK_PARSE_STATE_GOT_STX;
+            this->rx_parse_msg.len = 0;
+            mavlink_start_checksum(&this->rx_parse_msg);
+        }
+        return false;
+    }
+
+    return result == MAVLINK_FRAMING_OK;
+}
+
+void MavQuadCopter::receive_batch()
+{
+    using namespace std::chrono;
+
+    unsigned int batch_size = this->rx_msgs.size();
+    uint64_t packets = 0;
+    uint64_t messages = 0;
+    steady_clock::duration parse_time = steady_clock::duration::zero();
+
+    mavlink_message_t msg;
+
+    while (true) {
+        int n = recvmmsg(this->sock, this->rx_msgs.data(), batch_size,
+                         MSG_DONTWAIT, nullptr);
+        if (n <= 0) {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+                errno != EINTR) {
+                perror("[MavQuadCopter] error receiving");
+            }
+            break;
+        }
+
+        steady_clock::time_point start = steady_clock::now();
+
+        for (int i = 0; i < n; i++) {
+            const uint8_t *data = (const uint8_t *) this->rx_iov[i].iov_base;
+            unsigned int len = this->rx_msgs[i].msg_len;
+
+            for (unsigned int j = 0; j < len; j++) {
+                if (this->parse_char(data[j], msg)) {
+                    this->mav->handle_message(&msg);
+                    messages++;
+                }
+            }
+        }
+
+        // Time to parse and handle each batch of datagrams
+        steady_clock::duration batch_time = steady_clock::now() - start;
+        rx_latency.record(batch_time);
+        parse_time += batch_time;
+        packets += n;
+
+        // A partial batch means the socket is empty
+        if ((unsigned int) n < batch_size) {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> locker(this->rx_stats_mtx);
+    this->rx_stats.wakeups++;
+    this->rx_stats.packets += packets;
+    this->rx_stats.messages += messages;
+    this->rx_stats.max_batch = std::max(this->rx_stats.max_batch, packets);
+    this->rx_stats.parse_time += duration<double>(parse_time).count();
 }
 
+MavRxStats MavQuadCopter::get_rx_stats()
+{
+    std::lock_guard<std::mutex> locker(this->rx_stats_mtx);
+    return this->rx_stats;
+}
+
+bool MavQuadCopter::set_io_realtime(int cpu, int priority)
+{
+    pthread_t handle = this->thread.native_handle();
+
+    if (cpu >= 0 && !realtime_pin_thread(handle, cpu)) {
+        return false;
+    }
+
+    return realtime_set_priority(handle, priority);
+}
@@ -16,14 +16,94 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <netinet/in.h>
+#include <sys/socket.h>
 #include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
 
 #include <mavlink_vehicles.hh>
 
+#include "common/pose_history.hh"
+#include "common/seqlock.hh"
 #include "vehicles/Vehicles.hh"
 
+/**
+ * Local tangent plane at the home position. Global coordinates are an affine
+ * function of local NED offsets, in meters:
+ *
+ *     global = home + north * x + east * y + down * z
+ *
+ * with each axis in global_pos_int units per meter. It is linearized from
+ * mavlink_vehicles::math::local_ned_to_global whenever home changes. Within
+ * 150 m of home it matches the exact conversion to the 1e-7 degree
+ * resolution of global_pos_int, and within a few centimeters at 700 m.
+ */
+struct LocalFrame {
+    bool valid = false;
+    mavlink_vehicles::global_pos_int home;
+    glm::dvec3 north = glm::dvec3(0, 0, 0);
+    glm::dvec3 east = glm::dvec3(0, 0, 0);
+    glm::dvec3 down = glm::dvec3(0, 0, 0);
+
+    void update(const mavlink_vehicles::global_pos_int &home);
+    mavlink_vehicles::global_pos_int to_global(
+            const mavlink_vehicles::local_pos &pos) const;
+};
+
+/**
+ * @brief Mission waypoint in local ENU coordinates around home, as returned
+ * by MavQuadCopter::target_pose().
+ */
+Pose mission_target_pose(const mavlink_vehicles::global_pos_int &waypoint,
+                         const mavlink_vehicles::global_pos_int &home);
+
+/**
+ * Vehicle state as published by the I/O thread, already converted to local
+ * ENU coordinates.
+ */
+struct VehicleState {
+    // When the snapshot was taken
+    std::chrono::steady_clock::time_point timestamp;
+    bool ready = false;
+    mavlink_vehicles::mode mode = mavlink_vehicles::mode::OTHER;
+
+    // Vehicle position and attitude, as returned by vehicle_pose()
+    Pose pose;
+    // Mission waypoint, as returned by target_pose()
+    Pose target;
+    glm::dvec3 velocity = glm::dvec3(0, 0, 0);
+
+    mavlink_vehicles::global_pos_int home;
+    mavlink_vehicles::global_pos_int mission_waypoint;
+
+    // Tangent plane at home, to convert local targets back to global
+    LocalFrame frame;
+};
+
+/**
+ * @brief Flight direction of a vehicle in the given state, as returned by
+ * MavQuadCopter::flight_direction().
+ */
+glm::dvec3 flight_direction(const VehicleState &state);
+
+struct MavRxStats {
+    // Wakeups on which the socket was drained
+    uint64_t wakeups = 0;
+    uint64_t packets = 0;
+    uint64_t messages = 0;
+    // Most packets drained on a single wakeup
+    uint64_t max_batch = 0;
+    // Total time spent parsing, in seconds
+    double parse_time = 0;
+};
+
 class MavQuadCopter : public QuadCopter
 {
   public:
@@ -32,12 +112,77 @@ class MavQuadCopter : public QuadCopter
     MavQuadCopter();
     ~MavQuadCopter();
 
+    /**
+     * @brief Latest state snapshot. Lock free, so it can be called as often
+     * as needed; calling it once per frame gives a consistent view.
+     */
+    VehicleState get_state();
+
     Pose target_pose() override;
     Pose vehicle_pose() override;
     void set_target_pose(Pose pose) override;
+
+    /**
+     * @brief Vehicle pose at a past time, such as the capture time of a
+     * depth frame, interpolated from the recent pose history. The current
+     * pose is returned for times the history does not cover.
+     */
+    Pose vehicle_pose_at(std::chrono::steady_clock::time_point time);
     void rotate(double angle_deg);
     bool detour_finished();
 
+    /**
+     * @brief Vehicle velocity in local ENU coordinates, in m/s.
+     */
+    glm::dvec3 vehicle_velocity();
+
+    /**
+     * @brief Direction the vehicle is flying to, in the vehicle frame
+     * (x right, y forward, z up). It is the velocity while moving and the
+     * direction of the mission waypoint otherwise. Null if unknown.
+     */
+    glm::dvec3 flight_direction();
+
+    /**
+     * @brief Stream a velocity setpoint, in local ENU coordinates (m/s), and
+     * a yaw rate (rad/s, counterclockwise) to the vehicle.
+     *
+     * The setpoint is sent at a fixed rate by the I/O thread, so callers
+     * only need to update it when it changes. The vehicle is switched to
+     * GUIDED mode while streaming. If the setpoint is not refreshed within
+     * the timeout, the vehicle is told to hold its position.
+     */
+    void set_target_velocity(const glm::dvec3 &velocity, double yaw_rate = 0);
+
+    /**
+     * @brief Stop streaming velocity setpoints and resume the mission.
+     */
+    void stop_target_velocity();
+    bool is_velocity_streaming();
+
+    /**
+     * @brief Send an OBSTACLE_DISTANCE message, so the autopilot can do its
+     * own proximity avoidance. time_usec is filled in.
+     */
+    void send_obstacle_distance(mavlink_obstacle_distance_t &obstacle_distance);
+
+    /**
+     * @brief Fraction of a core used by the I/O thread, averaged over the
+     * last few seconds.
+     */
+    double io_cpu_usage();
+
+    /**
+     * @brief Counters of the batched MAVLink receive path.
+     */
+    MavRxStats get_rx_stats();
+
+    /**
+     * @brief Pin the I/O thread to a CPU and give it a SCHED_FIFO priority.
+     * A negative CPU leaves the affinity unchanged.
+     */
+    bool set_io_realtime(int cpu, int priority);
+
     // Mavlink vehicle
     std::shared_ptr<mavlink_vehicles::mav_vehicle> mav;
 
@@ -49,10 +194,62 @@ class MavQuadCopter : public QuadCopter
     struct sockaddr_in local_addr = {0};
     struct sockaddr_in remote_addr = {0};
 
-    // Run Thread
+    // Run Thread. It sleeps on an epoll set and only wakes up when the
+    // socket is readable, a timer expires or it is asked to stop.
     void run();
+    void update_state();
     std::thread thread;
-    bool thread_run = false;
+    std::atomic<bool> thread_run{false};
+    int epoll_fd = -1;
+    int tick_fd = -1;
+    int velocity_fd = -1;
+    int wakeup_fd = -1;
+
+    // Batched receive. The socket is drained with recvmmsg into a
+    // preallocated packet ring and the batch is parsed in one go.
+    void receive_batch();
+    bool batch_rx = false;
+    std::vector<uint8_t> rx_buffer;
+    std::vector<struct iovec> rx_iov;
+    std::vector<struct mmsghdr> rx_msgs;
+    std::mutex rx_stats_mtx;
+
+    // Parser state of this vehicle. The MAVLINK_COMM_n channels are global,
+    // and vehicles of the same process receive concurrently.
+    bool parse_char(uint8_t c, mavlink_message_t &msg);
+    mavlink_message_t rx_parse_msg = {};
+    mavlink_status_t rx_parse_status = {};
+    MavRxStats rx_stats;
+
+    // CPU time used by the run thread
+    void update_cpu_usage();
+    std::atomic<double> cpu_usage{0};
+    std::chrono::steady_clock::time_point cpu_sample_time;
+    double cpu_sample = 0;
+
+    // State snapshot, only written by the run thread
+    void publish_state();
+    SeqLock<VehicleState> state;
+
+    // Poses of the last few seconds, for latency compensation
+    std::mutex pose_history_mtx;
+    PoseHistory pose_history;
+
+    // Velocity estimated from consecutive local positions
+    void update_velocity();
+    glm::dvec3 velocity = glm::dvec3(0, 0, 0);
+    mavlink_vehicles::local_pos last_pos;
+    std::chrono::steady_clock::time_point last_pos_time;
+
+    // Velocity setpoint streaming, driven by the velocity timer
+    void send_velocity_setpoint();
+    void send_velocity(const glm::dvec3 &velocity, double yaw_rate);
+    void set_timer(int fd, double period_sec);
+    std::mutex velocity_sp_mtx;
+    bool velocity_sp_active = false;
+    glm::dvec3 velocity_sp = glm::dvec3(0, 0, 0);
+    double yaw_rate_sp = 0;
+    std::chrono::steady_clock::time_point velocity_sp_time;
 
     // Vehicle state
     enum vstate { INIT, INIT_ON_GROUND, ACTIVE_ON_GROUND, ACTIVE_AIRBORNE };
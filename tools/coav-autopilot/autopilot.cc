@@ -0,0 +1,530 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "autopilot.hh"
+
+namespace defaults
+{
+const uint8_t sysid = 1;
+const uint8_t compid = 1;
+// ArduPilot SITL default home
+const int32_t home_lat = -353632610;
+const int32_t home_lon = 1491652300;
+// Waypoints are reached within this distance, in meters
+const double wp_radius = 1.0;
+// ArduCopter stops when velocity targets stop arriving for this long
+const double velocity_target_timeout = 3.0;
+const double heartbeat_period_sec = 1.0;
+// SET_POSITION_TARGET_* type mask bits
+const uint16_t ignore_position = 0x0007;
+const uint16_t ignore_velocity = 0x0038;
+const uint16_t ignore_yaw = 0x0400;
+const uint16_t ignore_yaw_rate = 0x0800;
+}
+
+SimAutopilot::SimAutopilot(uint16_t remote_port,
+        const std::vector<glm::dvec3> &mission, bool airborne,
+        KinematicLimits limits)
+    : model(limits)
+{
+    this->sock = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (this->sock == -1) {
+        perror("[SimAutopilot] error opening socket");
+        exit(EXIT_FAILURE);
+    }
+
+    if (fcntl(this->sock, F_SETFL, O_NONBLOCK) < 0) {
+        perror("[SimAutopilot] error setting socket as nonblocking");
+        close(this->sock);
+        exit(EXIT_FAILURE);
+    }
+
+    this->remote_addr.sin_family = AF_INET;
+    this->remote_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    this->remote_addr.sin_port = htons(remote_port);
+
+    this->home = mavlink_vehicles::global_pos_int(defaults::home_lat,
+            defaults::home_lon, 0);
+
+    this->mission.push_back(glm::dvec3(0, 0, 0));
+    this->mission.insert(this->mission.end(), mission.begin(), mission.end());
+
+    // When airborne, start hovering at the altitude of the first waypoint
+    // and on the mission
+    this->armed = airborne;
+    this->flying = airborne;
+    this->mode = airborne ? Mode::AUTO : Mode::STABILIZE;
+
+    double altitude = airborne && this->mission.size() > 1 ?
+        this->mission[1].z : 0;
+    this->model.reset(glm::dvec3(0, 0, altitude), 0);
+    this->update_targets();
+
+    this->next_heartbeat = std::chrono::steady_clock::now();
+}
+
+SimAutopilot::~SimAutopilot()
+{
+    close(this->sock);
+}
+
+QuadModel &SimAutopilot::get_model()
+{
+    return this->model;
+}
+
+double SimAutopilot::get_time()
+{
+    return this->time;
+}
+
+uint32_t SimAutopilot::get_mode()
+{
+    return this->mode;
+}
+
+bool SimAutopilot::mission_complete()
+{
+    return this->reached == this->mission.size() - 1;
+}
+
+unsigned int SimAutopilot::waypoints_reached()
+{
+    return this->reached;
+}
+
+glm::dvec3 SimAutopilot::to_local(int32_t lat, int32_t lon, double alt)
+{
+    mavlink_vehicles::local_pos pos = mavlink_vehicles::math::global_to_local_ned(
+            mavlink_vehicles::global_pos_int(lat, lon, 0), this->home);
+
+    return glm::dvec3(pos.x, pos.y, -alt);
+}
+
+void SimAutopilot::to_global(glm::dvec3 position, int32_t &lat, int32_t &lon)
+{
+    mavlink_vehicles::global_pos_int global =
+        mavlink_vehicles::math::local_ned_to_global(
+            mavlink_vehicles::local_pos(position.x, position.y, 0), this->home);
+
+    lat = global.lat;
+    lon = global.lon;
+}
+
+void SimAutopilot::set_mode(uint32_t mode)
+{
+    if (mode == this->mode) {
+        return;
+    }
+
+    this->mode = mode;
+    this->velocity_target_active = false;
+
+    // Entering guided, or any mode without navigation, holds the position
+    this->model.hold();
+    this->update_targets();
+}
+
+void SimAutopilot::update_targets()
+{
+    if (!this->flying) {
+        return;
+    }
+
+    if (this->mode == Mode::AUTO) {
+        if (this->mission_seq >= this->mission.size()) {
+            this->model.hold();
+            return;
+        }
+
+        this->model.set_position_target(this->mission[this->mission_seq]);
+
+        if (this->model.distance_to_target() <= defaults::wp_radius) {
+            this->reached = glm::max(this->reached, (unsigned int) this->mission_seq);
+            if (this->mission_seq + 1u < this->mission.size()) {
+                this->mission_seq++;
+                this->model.set_position_target(this->mission[this->mission_seq]);
+            }
+        }
+    } else if (this->mode == Mode::GUIDED) {
+        if (this->velocity_target_active &&
+                this->time - this->velocity_target_time >
+                defaults::velocity_target_timeout) {
+            this->velocity_target_active = false;
+            this->model.hold();
+        }
+    } else {
+        this->model.hold();
+    }
+}
+
+void SimAutopilot::step(double dt)
+{
+    this->time += dt;
+    this->update_targets();
+    this->model.step(dt);
+}
+
+void SimAutopilot::receive()
+{
+    uint8_t buf[2048];
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    mavlink_message_t msg;
+    mavlink_status_t status;
+
+    while (true) {
+        ssize_t len = recvfrom(this->sock, buf, sizeof(buf), 0,
+                (struct sockaddr *) &addr, &addr_len);
+        if (len <= 0) {
+            break;
+        }
+
+        for (ssize_t i = 0; i < len; i++) {
+            if (mavlink_parse_char(MAVLINK_COMM_0, buf[i], &msg, &status)) {
+                this->handle_message(msg);
+            }
+        }
+    }
+}
+
+void SimAutopilot::handle_message(const mavlink_message_t &msg)
+{
+    this->remote_sysid = msg.sysid;
+
+    switch (msg.msgid) {
+    case MAVLINK_MSG_ID_SET_MODE: {
+        mavlink_set_mode_t set_mode;
+        mavlink_msg_set_mode_decode(&msg, &set_mode);
+        this->set_mode(set_mode.custom_mode);
+        break;
+    }
+    case MAVLINK_MSG_ID_COMMAND_LONG: {
+        mavlink_command_long_t cmd;
+        mavlink_msg_command_long_decode(&msg, &cmd);
+        this->handle_command(cmd);
+        break;
+    }
+    case MAVLINK_MSG_ID_MISSION_REQUEST_LIST: {
+        mavlink_mission_count_t count = {};
+        count.target_system = msg.sysid;
+        count.target_component = msg.compid;
+        count.count = this->mission.size();
+
+        mavlink_message_t reply;
+        mavlink_msg_mission_count_encode(defaults::sysid, defaults::compid,
+                &reply, &count);
+        this->send(reply);
+        break;
+    }
+    case MAVLINK_MSG_ID_MISSION_REQUEST: {
+        mavlink_mission_request_t req;
+        mavlink_msg_mission_request_decode(&msg, &req);
+        this->send_mission_item(req.seq, false);
+        break;
+    }
+    case MAVLINK_MSG_ID_MISSION_REQUEST_INT: {
+        mavlink_mission_request_int_t req;
+        mavlink_msg_mission_request_int_decode(&msg, &req);
+        this->send_mission_item(req.seq, true);
+        break;
+    }
+    case MAVLINK_MSG_ID_MISSION_ITEM: {
+        // Guided mode waypoints are mission items flagged with current = 2
+        mavlink_mission_item_t item;
+        mavlink_msg_mission_item_decode(&msg, &item);
+        if (item.current == 2) {
+            this->handle_detour(this->to_local(item.x * 1e7, item.y * 1e7, item.z));
+        }
+        break;
+    }
+    case MAVLINK_MSG_ID_MISSION_ITEM_INT: {
+        mavlink_mission_item_int_t item;
+        mavlink_msg_mission_item_int_decode(&msg, &item);
+        if (item.current == 2) {
+            this->handle_detour(this->to_local(item.x, item.y, item.z));
+        }
+        break;
+    }
+    case MAVLINK_MSG_ID_SET_POSITION_TARGET_LOCAL_NED: {
+        mavlink_set_position_target_local_ned_t target;
+        mavlink_msg_set_position_target_local_ned_decode(&msg, &target);
+        this->handle_local_target(target);
+        break;
+    }
+    case MAVLINK_MSG_ID_SET_POSITION_TARGET_GLOBAL_INT: {
+        mavlink_set_position_target_global_int_t target;
+        mavlink_msg_set_position_target_global_int_decode(&msg, &target);
+        if (!(target.type_mask & defaults::ignore_position)) {
+            this->handle_detour(this->to_local(target.lat_int, target.lon_int,
+                    target.alt));
+        }
+        break;
+    }
+    case MAVLINK_MSG_ID_PARAM_SET: {
+        mavlink_param_set_t param;
+        mavlink_msg_param_set_decode(&msg, &param);
+
+        std::string id(param.param_id, strnlen(param.param_id, sizeof(param.param_id)));
+        if (id == "WP_YAW_BEHAVIOR") {
+            this->model.set_auto_yaw(param.param_value != 0);
+        }
+
+        // Echo the new value back, as an acknowledgement
+        mavlink_message_t reply;
+        mavlink_msg_param_value_pack(defaults::sysid, defaults::compid, &reply,
+                param.param_id, param.param_value, param.param_type, 0, 0);
+        this->send(reply);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void SimAutopilot::handle_command(const mavlink_command_long_t &cmd)
+{
+    uint8_t result = MAV_RESULT_ACCEPTED;
+
+    switch (cmd.command) {
+    case MAV_CMD_COMPONENT_ARM_DISARM:
+        if (this->flying && cmd.param1 == 0) {
+            result = MAV_RESULT_DENIED;
+        } else {
+            this->armed = cmd.param1 != 0;
+        }
+        break;
+    case MAV_CMD_NAV_TAKEOFF:
+        if (!this->armed || this->mode != Mode::GUIDED || this->flying) {
+            result = MAV_RESULT_DENIED;
+        } else {
+            glm::dvec3 pos = this->model.get_position();
+            this->flying = true;
+            this->model.set_position_target(glm::dvec3(pos.x, pos.y, -cmd.param7));
+        }
+        break;
+    case MAV_CMD_DO_SET_MODE:
+        this->set_mode((uint32_t) cmd.param2);
+        break;
+    case MAV_CMD_MISSION_START:
+        this->set_mode(Mode::AUTO);
+        break;
+    case MAV_CMD_CONDITION_YAW: {
+        // param1: angle, param3: direction (-1 ccw, 1 cw), param4: relative
+        double angle = glm::radians(cmd.param1);
+        if (cmd.param4 != 0) {
+            angle = this->model.get_yaw() + (cmd.param3 < 0 ? -angle : angle);
+        }
+        this->model.set_auto_yaw(false);
+        this->model.set_yaw_target(angle);
+        break;
+    }
+    case MAV_CMD_GET_HOME_POSITION:
+        this->send_home();
+        break;
+    default:
+        result = MAV_RESULT_UNSUPPORTED;
+        break;
+    }
+
+    this->send_ack(cmd.command, result);
+}
+
+void SimAutopilot::handle_detour(glm::dvec3 position)
+{
+    if (this->mode != Mode::GUIDED || !this->flying) {
+        return;
+    }
+
+    this->velocity_target_active = false;
+    this->model.set_position_target(position);
+}
+
+void SimAutopilot::handle_local_target(
+        const mavlink_set_position_target_local_ned_t &t)
+{
+    if (this->mode != Mode::GUIDED || !this->flying ||
+            t.coordinate_frame != MAV_FRAME_LOCAL_NED) {
+        return;
+    }
+
+    if (!(t.type_mask & defaults::ignore_position)) {
+        this->velocity_target_active = false;
+        this->model.set_position_target(glm::dvec3(t.x, t.y, t.z));
+    } else if (!(t.type_mask & defaults::ignore_velocity)) {
+        this->velocity_target_active = true;
+        this->velocity_target_time = this->time;
+        this->model.set_velocity_target(glm::dvec3(t.vx, t.vy, t.vz));
+    }
+
+    if (!(t.type_mask & defaults::ignore_yaw)) {
+        this->model.set_yaw_target(t.yaw);
+    } else if (!(t.type_mask & defaults::ignore_yaw_rate)) {
+        this->model.set_yaw_rate_target(t.yaw_rate);
+    }
+}
+
+void SimAutopilot::send(mavlink_message_t &msg)
+{
+    uint8_t buf[MAVLINK_MAX_PACKET_LEN];
+    uint16_t len = mavlink_msg_to_send_buffer(buf, &msg);
+
+    if (sendto(this->sock, buf, len, 0, (const struct sockaddr *) &this->remote_addr,
+            sizeof(this->remote_addr)) < 0 && errno != ECONNREFUSED) {
+        perror("[SimAutopilot] error sending message");
+    }
+}
+
+void SimAutopilot::send_ack(uint16_t command, uint8_t result)
+{
+    mavlink_command_ack_t ack = {};
+    ack.command = command;
+    ack.result = result;
+
+    mavlink_message_t msg;
+    mavlink_msg_command_ack_encode(defaults::sysid, defaults::compid, &msg, &ack);
+    this->send(msg);
+}
+
+void SimAutopilot::send_heartbeat()
+{
+    uint8_t base_mode = MAV_MODE_FLAG_CUSTOM_MODE_ENABLED;
+    if (this->armed) {
+        base_mode |= MAV_MODE_FLAG_SAFETY_ARMED;
+    }
+
+    mavlink_message_t msg;
+    mavlink_msg_heartbeat_pack(defaults::sysid, defaults::compid, &msg,
+            MAV_TYPE_QUADROTOR, MAV_AUTOPILOT_ARDUPILOTMEGA, base_mode,
+            this->mode, this->flying ? MAV_STATE_ACTIVE : MAV_STATE_STANDBY);
+    this->send(msg);
+
+    mavlink_mission_current_t current = {};
+    current.seq = this->mission_seq;
+    mavlink_msg_mission_current_encode(defaults::sysid, defaults::compid, &msg,
+            &current);
+    this->send(msg);
+}
+
+void SimAutopilot::send_home()
+{
+    mavlink_home_position_t home = {};
+    home.latitude = this->home.lat;
+    home.longitude = this->home.lon;
+    home.altitude = 0;
+    home.q[0] = 1;
+
+    mavlink_message_t msg;
+    mavlink_msg_home_position_encode(defaults::sysid, defaults::compid, &msg,
+            &home);
+    this->send(msg);
+}
+
+void SimAutopilot::send_mission_item(uint16_t seq, bool use_int)
+{
+    if (seq >= this->mission.size()) {
+        return;
+    }
+
+    glm::dvec3 wp = this->mission[seq];
+    int32_t lat, lon;
+    this->to_global(wp, lat, lon);
+
+    // Same fields for both messages, only the coordinates differ. The home
+    // position is absolute, waypoints are relative to it.
+    mavlink_mission_item_int_t item = {};
+    item.target_system = this->remote_sysid;
+    item.seq = seq;
+    item.frame = seq ? MAV_FRAME_GLOBAL_RELATIVE_ALT : MAV_FRAME_GLOBAL;
+    item.command = MAV_CMD_NAV_WAYPOINT;
+    item.current = seq == this->mission_seq;
+    item.autocontinue = 1;
+    item.x = lat;
+    item.y = lon;
+    item.z = -wp.z;
+
+    mavlink_message_t msg;
+
+    if (use_int) {
+        mavlink_msg_mission_item_int_encode(defaults::sysid, defaults::compid,
+                &msg, &item);
+    } else {
+        mavlink_mission_item_t item_float = {};
+        item_float.target_system = item.target_system;
+        item_float.seq = item.seq;
+        item_float.frame = item.frame;
+        item_float.command = item.command;
+        item_float.current = item.current;
+        item_float.autocontinue = item.autocontinue;
+        item_float.x = lat / 1e7;
+        item_float.y = lon / 1e7;
+        item_float.z = item.z;
+        mavlink_msg_mission_item_encode(defaults::sysid, defaults::compid,
+                &msg, &item_float);
+    }
+
+    this->send(msg);
+}
+
+void SimAutopilot::send_telemetry()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    // Low rate messages follow the wall clock, since the other end times
+    // out on it
+    if (now >= this->next_heartbeat) {
+        this->send_heartbeat();
+        this->send_home();
+        this->next_heartbeat = now + std::chrono::duration_cast<
+            std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(defaults::heartbeat_period_sec));
+    }
+
+    uint32_t time_boot_ms = this->time * 1000;
+    glm::dvec3 pos = this->model.get_position();
+    glm::dvec3 vel = this->model.get_velocity();
+    double yaw = this->model.get_yaw();
+    int32_t lat, lon;
+    this->to_global(pos, lat, lon);
+
+    mavlink_message_t msg;
+
+    mavlink_msg_attitude_pack(defaults::sysid, defaults::compid, &msg,
+            time_boot_ms, 0, 0, yaw, 0, 0, this->model.get_yaw_rate());
+    this->send(msg);
+
+    mavlink_msg_local_position_ned_pack(defaults::sysid, defaults::compid,
+            &msg, time_boot_ms, pos.x, pos.y, pos.z, vel.x, vel.y, vel.z);
+    this->send(msg);
+
+    double heading = glm::degrees(yaw < 0 ? yaw + 2 * M_PI : yaw);
+    mavlink_msg_global_position_int_pack(defaults::sysid, defaults::compid,
+            &msg, time_boot_ms, lat, lon, -pos.z * 1000, -pos.z * 1000,
+            vel.x * 100, vel.y * 100, vel.z * 100, heading * 100);
+    this->send(msg);
+}
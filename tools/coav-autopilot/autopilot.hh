@@ -0,0 +1,117 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <netinet/in.h>
+#include <vector>
+
+#include <coav/coav.hh>
+#include <mavlink_vehicles.hh>
+
+#include "model.hh"
+
+/**
+ * Stand-in for an ArduCopter autopilot, flying a QuadModel.
+ *
+ * Speaks the subset of MAVLink used by MavQuadCopter over UDP: heartbeat,
+ * position and attitude telemetry, home position, mission download, mode
+ * changes, arming, takeoff, yaw commands, detour waypoints and position or
+ * velocity targets. Positions are local NED, in meters, from the home
+ * position.
+ */
+class SimAutopilot
+{
+public:
+    // ArduCopter custom modes
+    enum Mode : uint32_t {
+        STABILIZE = 0,
+        AUTO = 3,
+        GUIDED = 4,
+        LOITER = 5,
+        BRAKE = 17,
+    };
+
+    SimAutopilot(uint16_t remote_port, const std::vector<glm::dvec3> &mission,
+            bool airborne, KinematicLimits limits = KinematicLimits());
+    ~SimAutopilot();
+
+    /**
+     * @brief Handle all pending messages.
+     */
+    void receive();
+
+    /**
+     * @brief Advance the simulation by 'dt' seconds of simulated time.
+     */
+    void step(double dt);
+
+    /**
+     * @brief Send position and attitude, plus the low rate messages when
+     * they are due.
+     */
+    void send_telemetry();
+
+    QuadModel &get_model();
+    double get_time();
+    uint32_t get_mode();
+
+    // Mission waypoints reached so far, and whether all of them were
+    bool mission_complete();
+    unsigned int waypoints_reached();
+
+private:
+    int sock = -1;
+    struct sockaddr_in remote_addr = {};
+    uint8_t remote_sysid = 0;
+
+    QuadModel model;
+    double time = 0;
+
+    uint32_t mode;
+    bool armed;
+    bool flying;
+
+    // Item 0 is the home position, as on ArduPilot
+    std::vector<glm::dvec3> mission;
+    uint16_t mission_seq = 1;
+    unsigned int reached = 0;
+    mavlink_vehicles::global_pos_int home;
+
+    // Velocity targets are dropped when they stop arriving
+    double velocity_target_time = 0;
+    bool velocity_target_active = false;
+
+    std::chrono::steady_clock::time_point next_heartbeat;
+
+    void handle_message(const mavlink_message_t &msg);
+    void handle_command(const mavlink_command_long_t &cmd);
+    void handle_detour(glm::dvec3 position);
+    void handle_local_target(const mavlink_set_position_target_local_ned_t &t);
+    void set_mode(uint32_t mode);
+    void update_targets();
+
+    void send(mavlink_message_t &msg);
+    void send_ack(uint16_t command, uint8_t result);
+    void send_heartbeat();
+    void send_home();
+    void send_mission_item(uint16_t seq, bool use_int);
+
+    glm::dvec3 to_local(int32_t lat, int32_t lon, double alt);
+    void to_global(glm::dvec3 position, int32_t &lat, int32_t &lon);
+};
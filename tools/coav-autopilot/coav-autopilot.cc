@@ -0,0 +1,255 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <coav/coav.hh>
+
+#include "autopilot.hh"
+
+namespace defaults
+{
+const uint16_t remote_port = 15557;
+// Wall clock period of the simulation loop
+const double loop_period_sec = 0.005;
+// Longest simulated step, larger steps are split
+const double max_step_sec = 0.005;
+// Telemetry is sent every this many loop periods (50 Hz)
+const unsigned int telemetry_divider = 4;
+const double timeout_sec = 120.0;
+const double vehicle_radius = 0.3;
+}
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int)
+{
+    running = 0;
+}
+
+static void print_help(void)
+{
+    std::cout << "Usage: coav-autopilot [options]\n\n"
+        "Simulated autopilot for closed-loop tests of coav-control, without\n"
+        "SITL or Gazebo. Exits with 0 if the mission is completed without\n"
+        "collisions.\n\n"
+        "Options:\n"
+        "  -p, --port PORT\n"
+        "       UDP port coav-control listens on (default 15557)\n"
+        "  -w, --waypoint X,Y,Z\n"
+        "       Add a mission waypoint, in meters east, north and up from\n"
+        "       home. May be repeated (default 0,30,3)\n"
+        "  -f, --world FILE\n"
+        "       World description, used to check for collisions. Pass the\n"
+        "       same file to coav-control with ST_SIMULATED\n"
+        "  -s, --speedup FACTOR\n"
+        "       Simulated time per wall clock second (default 1)\n"
+        "  -t, --timeout SEC\n"
+        "       Give up after this much simulated time (default 120)\n"
+        "  -v, --max-speed SPEED\n"
+        "       Maximum horizontal speed, in m/s (default 5)\n"
+        "  -g, --ground\n"
+        "       Start landed and disarmed instead of flying the mission\n"
+        "  -h, --help\n"
+        "       Display this help and exit\n\n"
+        "Example:\n"
+        "  $ coav-autopilot -f pillars.world -w 0,30,3 -s 2 &\n"
+        "  $ coav-control -d DI_OBSTACLE -a QC_VFF -s ST_SIMULATED --world pillars.world"
+        << std::endl;
+}
+
+static bool parse_waypoint(const char *arg, std::vector<glm::dvec3> &mission)
+{
+    double east, north, up;
+    char end;
+
+    if (sscanf(arg, "%lf,%lf,%lf%c", &east, &north, &up, &end) != 3) {
+        return false;
+    }
+
+    // Mission is kept in local NED
+    mission.push_back(glm::dvec3(north, east, -up));
+    return true;
+}
+
+// Horizontal distance between the vehicle and the surface of a pillar.
+// Pillars the vehicle flies over do not count.
+static double pillar_clearance(const SimPillar &p, glm::dvec3 position,
+        double radius)
+{
+    if (-position.z > p.height + radius) {
+        return INFINITY;
+    }
+
+    double dist = glm::length(glm::dvec2(position.y - p.x, position.x - p.y));
+    return dist - p.radius - radius;
+}
+
+int main(int argc, char *argv[])
+{
+    uint16_t port = defaults::remote_port;
+    std::vector<glm::dvec3> mission;
+    std::vector<SimPillar> pillars;
+    double speedup = 1.0;
+    double timeout = defaults::timeout_sec;
+    bool airborne = true;
+    KinematicLimits limits;
+
+    static const struct option long_options[] = {
+        {"port", required_argument, nullptr, 'p'},
+        {"waypoint", required_argument, nullptr, 'w'},
+        {"world", required_argument, nullptr, 'f'},
+        {"speedup", required_argument, nullptr, 's'},
+        {"timeout", required_argument, nullptr, 't'},
+        {"max-speed", required_argument, nullptr, 'v'},
+        {"ground", no_argument, nullptr, 'g'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "p:w:f:s:t:v:gh", long_options,
+                    nullptr)) != -1) {
+        switch (opt) {
+        case 'p':
+            port = (uint16_t) atoi(optarg);
+            break;
+        case 'w':
+            if (!parse_waypoint(optarg, mission)) {
+                std::cerr << "ERROR: Invalid waypoint '" << optarg << "'" << std::endl;
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'f':
+            if (!load_sim_world(optarg, pillars)) {
+                return EXIT_FAILURE;
+            }
+            break;
+        case 's':
+            speedup = atof(optarg);
+            break;
+        case 't':
+            timeout = atof(optarg);
+            break;
+        case 'v':
+            limits.max_speed = atof(optarg);
+            break;
+        case 'g':
+            airborne = false;
+            break;
+        case 'h':
+            print_help();
+            return EXIT_SUCCESS;
+        default:
+            print_help();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (speedup <= 0 || timeout <= 0 || limits.max_speed <= 0) {
+        std::cerr << "ERROR: Speedup, timeout and speed must be positive" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (mission.empty()) {
+        parse_waypoint("0,30,3", mission);
+    }
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+
+    SimAutopilot autopilot(port, mission, airborne, limits);
+    QuadModel &model = autopilot.get_model();
+
+    DeadlineScheduler scheduler(std::chrono::duration_cast<
+            std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(defaults::loop_period_sec)));
+
+    double sim_period = defaults::loop_period_sec * speedup;
+    unsigned int substeps = (unsigned int) ceil(sim_period / defaults::max_step_sec);
+    double dt = sim_period / substeps;
+
+    double min_clearance = INFINITY;
+    double distance = 0;
+    double max_speed = 0;
+    unsigned int collisions = 0;
+    bool colliding = false;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (uint64_t loop = 0; running; loop++) {
+        scheduler.wait();
+        autopilot.receive();
+
+        for (unsigned int i = 0; i < substeps; i++) {
+            autopilot.step(dt);
+
+            glm::dvec3 position = model.get_position();
+            double clearance = INFINITY;
+            for (const SimPillar &p : pillars) {
+                clearance = glm::min(clearance, pillar_clearance(p,
+                        position, defaults::vehicle_radius));
+            }
+
+            min_clearance = glm::min(min_clearance, clearance);
+            distance += glm::length(model.get_velocity()) * dt;
+            max_speed = glm::max(max_speed, glm::length(model.get_velocity()));
+
+            if (clearance < 0 && !colliding) {
+                collisions++;
+                std::cout << "[coav-autopilot] Collision at t = "
+                          << autopilot.get_time() << " s, position (ENU) "
+                          << position.y << ", " << position.x << ", "
+                          << -position.z << std::endl;
+            }
+            colliding = clearance < 0;
+        }
+
+        if (loop % defaults::telemetry_divider == 0) {
+            autopilot.send_telemetry();
+        }
+
+        if (autopilot.mission_complete() || autopilot.get_time() >= timeout) {
+            break;
+        }
+    }
+
+    double wall_time = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+    bool success = autopilot.mission_complete() && collisions == 0;
+
+    printf("Mission %s: %u of %zu waypoints\n",
+           autopilot.mission_complete() ? "completed" : "not completed",
+           autopilot.waypoints_reached(), mission.size());
+    printf("Simulated time: %.1f s (%.1fx real time)\n", autopilot.get_time(),
+           wall_time > 0 ? autopilot.get_time() / wall_time : 0.0);
+    printf("Distance flown: %.1f m, max speed %.2f m/s\n", distance, max_speed);
+    printf("Collisions: %u, minimum clearance: %.2f m\n", collisions,
+           std::isinf(min_clearance) ? 0.0 : min_clearance);
+    printf("Control loop: %lu runs, %lu overruns\n",
+           (unsigned long) scheduler.get_stats().runs,
+           (unsigned long) scheduler.get_stats().overruns);
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
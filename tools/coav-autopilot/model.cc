@@ -0,0 +1,178 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <cmath>
+
+#include "model.hh"
+
+namespace defaults
+{
+// Auto yaw stops this close to the target, so the heading does not swing
+// around while the vehicle settles on it
+const double auto_yaw_min_dist = 2.0;
+}
+
+static double wrap_pi(double angle)
+{
+    return atan2(sin(angle), cos(angle));
+}
+
+QuadModel::QuadModel(KinematicLimits limits)
+{
+    this->limits = limits;
+}
+
+void QuadModel::reset(glm::dvec3 position, double yaw)
+{
+    this->position = position;
+    this->velocity = glm::dvec3(0, 0, 0);
+    this->yaw = wrap_pi(yaw);
+    this->yaw_rate = 0;
+    this->target_yaw = this->yaw;
+    this->yaw_mode = YawTarget::HEADING;
+    this->hold();
+}
+
+void QuadModel::set_position_target(glm::dvec3 position)
+{
+    this->target = Target::POSITION;
+    this->target_position = position;
+}
+
+void QuadModel::set_velocity_target(glm::dvec3 velocity)
+{
+    this->target = Target::VELOCITY;
+    this->target_velocity = velocity;
+}
+
+void QuadModel::hold()
+{
+    this->target = Target::HOLD;
+}
+
+void QuadModel::set_yaw_target(double yaw)
+{
+    this->yaw_mode = YawTarget::HEADING;
+    this->target_yaw = wrap_pi(yaw);
+}
+
+void QuadModel::set_yaw_rate_target(double yaw_rate)
+{
+    this->yaw_mode = YawTarget::RATE;
+    this->target_yaw_rate = yaw_rate;
+}
+
+void QuadModel::set_auto_yaw(bool enable)
+{
+    this->auto_yaw = enable;
+}
+
+glm::dvec3 QuadModel::get_position()
+{
+    return this->position;
+}
+
+glm::dvec3 QuadModel::get_velocity()
+{
+    return this->velocity;
+}
+
+double QuadModel::get_yaw()
+{
+    return this->yaw;
+}
+
+double QuadModel::get_yaw_rate()
+{
+    return this->yaw_rate;
+}
+
+double QuadModel::distance_to_target()
+{
+    return glm::length(this->target_position - this->position);
+}
+
+glm::dvec3 QuadModel::desired_velocity()
+{
+    glm::dvec3 desired(0, 0, 0);
+
+    if (this->target == Target::POSITION) {
+        // Fastest speed from which the vehicle can still stop on the target
+        glm::dvec3 diff = this->target_position - this->position;
+        double dist = glm::length(diff);
+        if (dist > 0) {
+            desired = diff * (sqrt(2.0 * this->limits.max_accel * dist) / dist);
+        }
+    } else if (this->target == Target::VELOCITY) {
+        desired = this->target_velocity;
+    }
+
+    double speed = glm::length(glm::dvec2(desired.x, desired.y));
+    if (speed > this->limits.max_speed) {
+        desired.x *= this->limits.max_speed / speed;
+        desired.y *= this->limits.max_speed / speed;
+    }
+    desired.z = glm::clamp(desired.z, -this->limits.max_climb_rate,
+            this->limits.max_climb_rate);
+
+    return desired;
+}
+
+void QuadModel::step(double dt)
+{
+    if (dt <= 0) {
+        return;
+    }
+
+    glm::dvec3 dv = this->desired_velocity() - this->velocity;
+    double max_dv = this->limits.max_accel * dt;
+    if (glm::length(dv) > max_dv) {
+        dv *= max_dv / glm::length(dv);
+    }
+
+    this->velocity += dv;
+    this->position += this->velocity * dt;
+
+    // Landed
+    if (this->position.z > 0) {
+        this->position.z = 0;
+        this->velocity.z = glm::min(this->velocity.z, 0.0);
+    }
+
+    this->step_yaw(dt);
+}
+
+void QuadModel::step_yaw(double dt)
+{
+    double max_step = this->limits.max_yaw_rate * dt;
+    double step;
+
+    if (this->yaw_mode == YawTarget::RATE) {
+        step = glm::clamp(this->target_yaw_rate * dt, -max_step, max_step);
+    } else {
+        glm::dvec3 diff = this->target_position - this->position;
+        if (this->auto_yaw && this->target == Target::POSITION &&
+                glm::length(glm::dvec2(diff.x, diff.y)) > defaults::auto_yaw_min_dist) {
+            this->target_yaw = atan2(diff.y, diff.x);
+        }
+
+        step = glm::clamp(wrap_pi(this->target_yaw - this->yaw), -max_step,
+                max_step);
+    }
+
+    this->yaw = wrap_pi(this->yaw + step);
+    this->yaw_rate = step / dt;
+}
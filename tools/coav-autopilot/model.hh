@@ -0,0 +1,92 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+struct KinematicLimits {
+    // Horizontal speed, in m/s
+    double max_speed = 5.0;
+    // Vertical speed, in m/s
+    double max_climb_rate = 2.5;
+    // Acceleration, in m/s^2
+    double max_accel = 3.0;
+    // Yaw rate, in rad/s
+    double max_yaw_rate = glm::radians(90.0);
+};
+
+/**
+ * Kinematic quadcopter model in the local NED frame.
+ *
+ * The vehicle follows either a position target, which it reaches with a
+ * trapezoidal speed profile, a velocity target or a hold (brake) command.
+ * Velocity changes are limited by the maximum acceleration and yaw by the
+ * maximum yaw rate. There are no aerodynamics: attitude is always level.
+ * The ground is the plane z = 0.
+ */
+class QuadModel
+{
+public:
+    QuadModel(KinematicLimits limits = KinematicLimits());
+
+    void reset(glm::dvec3 position, double yaw);
+
+    void set_position_target(glm::dvec3 position);
+    void set_velocity_target(glm::dvec3 velocity);
+    void hold();
+
+    void set_yaw_target(double yaw);
+    void set_yaw_rate_target(double yaw_rate);
+
+    /**
+     * @brief Point the vehicle at the position target while flying to it,
+     * like ArduCopter does with WP_YAW_BEHAVIOR set.
+     */
+    void set_auto_yaw(bool enable);
+
+    void step(double dt);
+
+    glm::dvec3 get_position();
+    glm::dvec3 get_velocity();
+    double get_yaw();
+    double get_yaw_rate();
+
+    double distance_to_target();
+
+private:
+    enum class Target { POSITION, VELOCITY, HOLD };
+    enum class YawTarget { HEADING, RATE };
+
+    KinematicLimits limits;
+
+    glm::dvec3 position = glm::dvec3(0, 0, 0);
+    glm::dvec3 velocity = glm::dvec3(0, 0, 0);
+    double yaw = 0;
+    double yaw_rate = 0;
+
+    Target target = Target::HOLD;
+    glm::dvec3 target_position = glm::dvec3(0, 0, 0);
+    glm::dvec3 target_velocity = glm::dvec3(0, 0, 0);
+
+    YawTarget yaw_mode = YawTarget::HEADING;
+    double target_yaw = 0;
+    double target_yaw_rate = 0;
+    bool auto_yaw = true;
+
+    glm::dvec3 desired_velocity();
+    void step_yaw(double dt);
+};
@@ -21,6 +21,7 @@
 #include <coav/coav.hh>
 
 #include "coav-control.hh"
+#include "pipeline.hh"
 
 #ifdef WITH_VDEBUG
 #include "visual.hh"
@@ -38,62 +39,44 @@ int main (int argc, char* argv[])
         cout << "Using Sensor: " << sensor_to_name(opts.sensor) << endl;
     }
 
-    shared_ptr<MavQuadCopter> vehicle = opts.port ?
-        std::make_shared<MavQuadCopter>(opts.port) : std::make_shared<MavQuadCopter>();
+    start_stats_service(opts);
 
-    shared_ptr<DepthCamera> sensor;
-
-    if (opts.sensor == ST_REALSENSE) {
-#ifdef HAVE_REALSENSE
-        sensor = make_shared<RealSenseCamera>(640, 480, 30);
-#endif
-    } else if (opts.sensor == ST_GAZEBO_REALSENSE) {
-#ifdef HAVE_GAZEBO
-        sensor = make_shared<GazeboRealSenseCamera>();
-#endif
-    }
-
-    if (opts.sensor == ST_UNDEFINED || sensor == nullptr) {
-        cerr << "ERROR: Invalid Sensor" << endl;
-        exit(-EINVAL);
-    }
-
-    shared_ptr<Detector> detector;
-    switch (opts.detect) {
-        case DI_OBSTACLE:
-            detector = make_shared<DepthImageObstacleDetector>(5.0);
-            break;
-        case DI_POLAR_HIST:
-            detector = make_shared<DepthImagePolarHistDetector>(5);
-            break;
-        default:
-            cerr << "ERROR: Invalid Detector" << endl;
-            exit(-EINVAL);
+    if (opts.vehicles > 1) {
+        run_multi_vehicle(opts);
     }
 
-    shared_ptr<CollisionAvoidanceStrategy<MavQuadCopter>> avoidance;
-    switch(opts.avoidance) {
-        case QC_SHIFT_AVOIDANCE:
-            avoidance = make_shared<QuadCopterShiftAvoidance>(vehicle);
-            break;
-        case QC_STOP:
-            avoidance = make_shared<QuadCopterStopAvoidance>(vehicle);
-            break;
-        case QC_VFF:
-            avoidance = make_shared<QuadCopterVFFAvoidance>(vehicle);
-            break;
-        default:
-            cerr << "ERROR: Invalid Avoidance" << endl;
-            exit(-EINVAL);
-    }
+    Pipeline p = make_pipeline(opts, opts.port);
+    start_realtime_profile(p, opts);
 
-    if (opts.vdebug) {
+    if (opts.pipelined) {
+        run_pipelined(p, opts);
+    } else if (opts.vdebug) {
 #ifdef WITH_VDEBUG
-        visual_mainlopp(argc, argv, vehicle, sensor, detector, avoidance);
+        visual_mainlopp(argc, argv, p.vehicle, p.sensor, p.detector, p.avoidance);
 #endif
     } else {
+        // All stages run on this thread
+        set_stage_realtime(opts, PS_DETECT);
+
+        // Frames that arrive while the strategy is not due would be thrown
+        // away, so sleep until its next deadline instead
+        DeadlineScheduler scheduler(p.avoidance->control_period());
+        uint64_t overruns = 0;
+
         while (true) {
-            avoidance->avoid(detector->detect(sensor->read()));
+            scheduler.wait();
+
+            const SchedulerStats &stats = scheduler.get_stats();
+            if (!opts.quiet && stats.overruns != overruns) {
+                overruns = stats.overruns;
+                cout << "[coav-control] deadline overrun, " << stats.skipped
+                     << " periods skipped in " << stats.runs << " runs, "
+                     << "max jitter " << stats.max_jitter * 1000.0 << " ms"
+                     << endl;
+            }
+
+            shared_ptr<DepthData> data = pipeline_sense(p);
+            pipeline_avoid(p, data, pipeline_detect(p, opts, data));
         }
     }
 
@@ -17,24 +17,36 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 enum detect_algorithm {
     DA_UNDEFINED = 0,
     DI_OBSTACLE,
     DI_POLAR_HIST,
+    DI_UV_DISPARITY,
+    DI_TTC,
+    DI_OBSTACLE_COARSE,
+    DI_CORRIDOR,
 };
 
 enum avoidance_algorithm {
     AA_UNDEFINED = 0,
     QC_SHIFT_AVOIDANCE,
     QC_STOP,
+    QC_STOP_BRAKING,
     QC_VFF,
+    QC_VFH,
+    QC_DWA,
+    QC_DSTAR,
+    QC_VFF_VELOCITY,
+    QC_OFFLOAD,
 };
 
 enum sensor_type {
     ST_UNDEFINED,
     ST_REALSENSE,
     ST_GAZEBO_REALSENSE,
+    ST_SIMULATED,
 };
 
 struct control_options {
@@ -44,6 +56,15 @@ struct control_options {
     unsigned int port;
     bool quiet;
     bool vdebug;
+    double roi_angle;
+    std::string world;
+    unsigned int vehicles;
+    unsigned int threads;
+    bool pipelined;
+    bool realtime;
+    std::vector<int> rt_cpus;
+    unsigned int latency_frames;
+    std::string stats_socket;
 };
 
 control_options parse_cmdline(int argc, char *argv[]);
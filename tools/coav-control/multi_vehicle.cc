@@ -0,0 +1,165 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pipeline.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace defaults
+{
+// Same as MavQuadCopter
+const unsigned int first_port = 15557;
+// Period of the strategies that run on every frame, the camera frame rate
+const double frame_period_sec = 1.0 / 30.0;
+const double stats_period_sec = 5.0;
+}
+
+struct VehicleSlot {
+    Pipeline pipeline;
+    unsigned int port;
+
+    // Only used by the dispatcher
+    DeadlineScheduler scheduler;
+
+    // Set while a cycle of the pipeline is queued or running
+    atomic<bool> busy;
+
+    // Since the last report
+    atomic<uint64_t> cycles;
+    atomic<uint64_t> skipped;
+
+    // From the dispatch of a cycle to the end of avoidance
+    LatencyHistogram latency;
+
+    VehicleSlot(Pipeline pipeline, unsigned int port,
+            steady_clock::duration period)
+        : pipeline(pipeline), port(port), scheduler(period), busy(false),
+        cycles(0), skipped(0), latency("vehicle." + to_string(port) + ".cycle")
+    {
+    }
+};
+
+static void dispatch(ThreadPool &pool, VehicleSlot &s,
+        const control_options &opts, steady_clock::time_point start)
+{
+    // Sensing, and detection plus avoidance, are separate tasks. The second
+    // one goes to the back of the queue of the worker that read the frame,
+    // so it usually runs next on the same core, but an idle worker can steal
+    // it.
+    pool.submit([&pool, &s, &opts, start]() {
+        shared_ptr<DepthData> data = pipeline_sense(s.pipeline);
+
+        pool.submit([&s, &opts, data, start]() {
+            pipeline_avoid(s.pipeline, data,
+                    pipeline_detect(s.pipeline, opts, data));
+            s.latency.record(steady_clock::now() - start);
+            s.cycles++;
+            s.busy = false;
+        });
+    });
+}
+
+static void print_stats(vector<unique_ptr<VehicleSlot>> &slots,
+        ThreadPool &pool, double interval)
+{
+    ThreadPoolStats pool_stats = pool.get_stats();
+
+    cout << "[coav-control] " << pool_stats.executed << " tasks, "
+         << pool_stats.stolen << " stolen" << endl;
+
+    for (unique_ptr<VehicleSlot> &s : slots) {
+        uint64_t cycles = s->cycles.exchange(0);
+        uint64_t skipped = s->skipped.exchange(0);
+
+        printf("[coav-control] port %u: %.1f cycles/s, %lu skipped\n",
+               s->port, cycles / interval, (unsigned long) skipped);
+    }
+
+    printf("[coav-control] latency\n%s", latency_report().c_str());
+
+    fflush(stdout);
+}
+
+void run_multi_vehicle(const control_options &opts)
+{
+    unsigned int first_port = opts.port ? opts.port : defaults::first_port;
+    steady_clock::duration frame_period = duration_cast<steady_clock::duration>(
+            duration<double>(defaults::frame_period_sec));
+    steady_clock::duration stats_period = duration_cast<steady_clock::duration>(
+            duration<double>(defaults::stats_period_sec));
+
+    ThreadPool pool(opts.threads);
+    vector<unique_ptr<VehicleSlot>> slots;
+
+    for (unsigned int i = 0; i < opts.vehicles; i++) {
+        // Frames are rendered on demand, the dispatcher does the pacing
+        Pipeline p = make_pipeline(opts, first_port + i, 0);
+
+        steady_clock::duration period = p.avoidance->control_period();
+        if (period <= steady_clock::duration::zero()) {
+            period = frame_period;
+        }
+
+        slots.emplace_back(new VehicleSlot(p, first_port + i, period));
+    }
+
+    if (!opts.quiet) {
+        cout << "[coav-control] " << opts.vehicles << " vehicles on ports "
+             << first_port << " to " << first_port + opts.vehicles - 1
+             << ", " << pool.get_num_threads() << " worker threads" << endl;
+    }
+
+    steady_clock::time_point next_stats = steady_clock::now() + stats_period;
+
+    while (true) {
+        steady_clock::time_point now = steady_clock::now();
+        steady_clock::time_point wakeup = next_stats;
+
+        for (unique_ptr<VehicleSlot> &s : slots) {
+            if (s->scheduler.due(now)) {
+                // A pipeline that is still busy misses this period
+                if (s->busy) {
+                    s->skipped++;
+                } else {
+                    s->busy = true;
+                    dispatch(pool, *s, opts, now);
+                }
+            }
+
+            wakeup = min(wakeup, s->scheduler.get_deadline());
+        }
+
+        if (now >= next_stats) {
+            if (!opts.quiet) {
+                print_stats(slots, pool, defaults::stats_period_sec);
+            }
+            next_stats += stats_period;
+            wakeup = min(wakeup, next_stats);
+        }
+
+        this_thread::sleep_until(wakeup);
+    }
+}
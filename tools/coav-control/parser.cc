@@ -15,7 +15,9 @@
 */
 
 #include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -53,21 +55,55 @@ void print_help(void)
         "       Detection Algorithms. Can be one of the following:\n"
         "           DI_OBSTACLE\n"
         "           DI_POLAR_HIST\n"
+        "           DI_UV_DISPARITY\n"
+        "           DI_TTC\n"
+        "           DI_OBSTACLE_COARSE\n"
+        "           DI_CORRIDOR\n"
         "  -a, --avoidance\n"
         "       Avoidance Algorithm. Can be one of the following:\n"
         "           QC_SHIFT_AVOIDANCE\n"
         "           QC_STOP\n"
+        "           QC_STOP_BRAKING\n"
         "           QC_VFF\n"
+        "           QC_VFH\n"
+        "           QC_DWA\n"
+        "           QC_DSTAR\n"
+        "           QC_VFF_VELOCITY\n"
+        "           QC_OFFLOAD (requires DI_POLAR_HIST)\n"
         "  -s, --sensor\n"
         "       Vehicle Sensor. Can be one of the following:\n"
         "           ST_REALSENSE\n"
         "           ST_GAZEBO_REALSENSE\n"
+        "           ST_SIMULATED (requires --world)\n"
         "  -p, --port\n"
         "       UDP port to use \n"
+        "  -n, --vehicles\n"
+        "       Number of vehicles to control, on consecutive UDP ports\n"
+        "       starting at --port. Requires ST_SIMULATED\n"
+        "  -j, --threads\n"
+        "       Worker threads shared by the vehicles, default is one per core\n"
+        "  -P, --pipelined\n"
+        "       Run sensing, detection and avoidance on a thread each\n"
+        "  -R, --realtime [CPUS]\n"
+        "       Real-time profile: lock memory, prefault buffers and run the\n"
+        "       stages with SCHED_FIFO. CPUS is a comma separated list to pin\n"
+        "       the sensor, detector, avoidance and MAVLink threads to, in this\n"
+        "       order; the last CPU is used for the remaining threads\n"
+        "  -L, --latency FRAMES\n"
+        "       Report the latency of sensing and detection over FRAMES frames\n"
+        "       at startup\n"
+        "  -S, --stats-socket PATH\n"
+        "       Serve the latency histograms of every stage on a UNIX socket.\n"
+        "       They are also printed on SIGUSR1\n"
         "  -q, --quiet\n"
         "       Supress info messages \n"
         "  -x, --visual\n"
-        "       Run visual debugger\n\n"
+        "       Run visual debugger\n"
+        "  -r, --roi\n"
+        "       Only look for obstacles within this angle, in degrees,\n"
+        "       of the flight direction\n"
+        "  -w, --world\n"
+        "       World file rendered by ST_SIMULATED, see coav-autopilot\n\n"
         "  -h, --help\n"
         "       Display this help and exit\n\n"
         "Example:\n"
@@ -84,6 +120,14 @@ string detect_to_name(detect_algorithm d)
             return string("DI_OBSTACLE");
         case DI_POLAR_HIST:
             return string("DI_POLAR_HIST");
+        case DI_UV_DISPARITY:
+            return string("DI_UV_DISPARITY");
+        case DI_TTC:
+            return string("DI_TTC");
+        case DI_OBSTACLE_COARSE:
+            return string("DI_OBSTACLE_COARSE");
+        case DI_CORRIDOR:
+            return string("DI_CORRIDOR");
     }
 
     return string("UNKOWN_VALUE");
@@ -97,6 +141,14 @@ detect_algorithm name_to_detect(string name)
         return DI_OBSTACLE;
     } else if (name == "DI_POLAR_HIST") {
         return DI_POLAR_HIST;
+    } else if (name == "DI_UV_DISPARITY") {
+        return DI_UV_DISPARITY;
+    } else if (name == "DI_TTC") {
+        return DI_TTC;
+    } else if (name == "DI_OBSTACLE_COARSE") {
+        return DI_OBSTACLE_COARSE;
+    } else if (name == "DI_CORRIDOR") {
+        return DI_CORRIDOR;
     }
 
     return DA_UNDEFINED;
@@ -111,8 +163,20 @@ string avoidance_to_name(avoidance_algorithm a)
             return string("QC_SHIFT_AVOIDANCE");
         case QC_STOP:
             return string("QC_STOP");
+        case QC_STOP_BRAKING:
+            return string("QC_STOP_BRAKING");
         case QC_VFF:
             return string("QC_VFF");
+        case QC_VFH:
+            return string("QC_VFH");
+        case QC_DWA:
+            return string("QC_DWA");
+        case QC_DSTAR:
+            return string("QC_DSTAR");
+        case QC_VFF_VELOCITY:
+            return string("QC_VFF_VELOCITY");
+        case QC_OFFLOAD:
+            return string("QC_OFFLOAD");
     }
 
     return string("UNKOWN_VALUE");
@@ -126,8 +190,20 @@ avoidance_algorithm name_to_avoidance(string name)
         return QC_SHIFT_AVOIDANCE;
     } else if (name == "QC_STOP") {
         return QC_STOP;
+    } else if (name == "QC_STOP_BRAKING") {
+        return QC_STOP_BRAKING;
     } else if (name == "QC_VFF") {
         return QC_VFF;
+    } else if (name == "QC_VFH") {
+        return QC_VFH;
+    } else if (name == "QC_DWA") {
+        return QC_DWA;
+    } else if (name == "QC_DSTAR") {
+        return QC_DSTAR;
+    } else if (name == "QC_VFF_VELOCITY") {
+        return QC_VFF_VELOCITY;
+    } else if (name == "QC_OFFLOAD") {
+        return QC_OFFLOAD;
     }
 
     return AA_UNDEFINED;
@@ -142,6 +218,8 @@ string sensor_to_name(sensor_type s)
             return string("ST_REALSENSE");
         case ST_GAZEBO_REALSENSE:
             return string("ST_GAZEBO_REALSENSE");
+        case ST_SIMULATED:
+            return string("ST_SIMULATED");
     }
 
     return string("UNKOWN_VALUE");
@@ -155,12 +233,37 @@ sensor_type name_to_sensor(string name)
         return ST_REALSENSE;
     } else if (name == "ST_GAZEBO_REALSENSE") {
         return ST_GAZEBO_REALSENSE;
+    } else if (name == "ST_SIMULATED") {
+        return ST_SIMULATED;
     }
 
     return ST_UNDEFINED;
 }
 
 
+vector<int> parse_cpu_list(string list)
+{
+    vector<int> cpus;
+
+    replace(list.begin(), list.end(), ',', ' ');
+    istringstream values(list);
+    string value;
+
+    while (values >> value) {
+        char *end;
+        long cpu = strtol(value.c_str(), &end, 10);
+
+        if (cpu < 0 || *end != '\0') {
+            cerr << "ERROR: Invalid CPU '" << value << "'" << endl;
+            exit(-EINVAL);
+        }
+
+        cpus.push_back(cpu);
+    }
+
+    return cpus;
+}
+
 vector<v_pair> get_arg_list(int argc, char* argv[])
 {
     vector<v_pair> list;
@@ -192,6 +295,15 @@ control_options parse_cmdline(int argc, char *argv[])
         .port = 0,
         .quiet = false,
         .vdebug = false,
+        .roi_angle = 0,
+        .world = "",
+        .vehicles = 1,
+        .threads = 0,
+        .pipelined = false,
+        .realtime = false,
+        .rt_cpus = {},
+        .latency_frames = 0,
+        .stats_socket = "",
     };
 
     for (v_pair p : list) {
@@ -245,6 +357,41 @@ control_options parse_cmdline(int argc, char *argv[])
         } else if (p.option == "-p" || p.option == "--port") {
             opts.port = (unsigned int) stoul(p.val);
 
+        // Vehicles
+        } else if (p.option == "-n" || p.option == "--vehicles") {
+            opts.vehicles = (unsigned int) stoul(p.val);
+
+            if (opts.vehicles == 0) {
+                cerr << "ERROR: Invalid number of vehicles '" << p.val << "'" << endl;
+                exit(-EINVAL);
+            }
+
+        // Threads
+        } else if (p.option == "-j" || p.option == "--threads") {
+            opts.threads = (unsigned int) stoul(p.val);
+
+        // Pipelined stages
+        } else if (p.option == "-P" || p.option == "--pipelined") {
+            opts.pipelined = true;
+
+        // Real-time profile
+        } else if (p.option == "-R" || p.option == "--realtime") {
+            opts.realtime = true;
+            opts.rt_cpus = parse_cpu_list(p.val);
+
+        // Startup latency report
+        } else if (p.option == "-L" || p.option == "--latency") {
+            opts.latency_frames = (unsigned int) stoul(p.val);
+
+        // Stats endpoint
+        } else if (p.option == "-S" || p.option == "--stats-socket") {
+            opts.stats_socket = p.val;
+
+            if (opts.stats_socket.empty()) {
+                cerr << "ERROR: Missing stats socket path" << endl;
+                exit(-EINVAL);
+            }
+
         // Quiet
         } else if (p.option == "-q" || p.option == "--quiet") {
             opts.quiet = true;
@@ -257,6 +404,19 @@ control_options parse_cmdline(int argc, char *argv[])
             cerr << "ERROR: Feature not  available 'visual debugger'" << endl;
 #endif
 
+        // Region of Interest
+        } else if (p.option == "-r" || p.option == "--roi") {
+            opts.roi_angle = stod(p.val);
+
+            if (opts.roi_angle <= 0 || opts.roi_angle >= 180) {
+                cerr << "ERROR: Invalid region of interest angle '" << p.val << "'" << endl;
+                exit(-EINVAL);
+            }
+
+        // Simulated world
+        } else if (p.option == "-w" || p.option == "--world") {
+            opts.world = p.val;
+
         //Help
         } else if (p.option == "-h" || p.option == "--help") {
             print_help();
@@ -268,6 +428,27 @@ control_options parse_cmdline(int argc, char *argv[])
         }
     }
 
+    if (opts.sensor == ST_SIMULATED && opts.world.empty()) {
+        cerr << "ERROR: ST_SIMULATED requires a world file" << endl;
+        exit(-EINVAL);
+    }
+
+    // Only simulated cameras can be instantiated once per vehicle
+    if (opts.vehicles > 1 && (opts.sensor != ST_SIMULATED || opts.vdebug)) {
+        cerr << "ERROR: Multiple vehicles require ST_SIMULATED and no visual debugger" << endl;
+        exit(-EINVAL);
+    }
+
+    if ((opts.realtime || opts.latency_frames) && (opts.vehicles > 1 || opts.vdebug)) {
+        cerr << "ERROR: Real-time profile and latency report are for a single vehicle without visual debugger" << endl;
+        exit(-EINVAL);
+    }
+
+    if (opts.pipelined && (opts.vehicles > 1 || opts.vdebug)) {
+        cerr << "ERROR: Pipelined mode is for a single vehicle without visual debugger" << endl;
+        exit(-EINVAL);
+    }
+
     return opts;
 }
 
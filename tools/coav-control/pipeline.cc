@@ -0,0 +1,348 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "pipeline.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+static LatencyHistogram detect_latency("detector.detect");
+static LatencyHistogram avoid_latency("avoidance.avoid");
+
+namespace defaults
+{
+// Stages wake up at least this often, so they never block for good
+const steady_clock::duration slot_timeout = seconds(1);
+const steady_clock::duration stats_period = seconds(5);
+}
+
+Pipeline make_pipeline(const control_options &opts, unsigned int port,
+        unsigned int sim_fps)
+{
+    shared_ptr<MavQuadCopter> vehicle = port ?
+        std::make_shared<MavQuadCopter>(port) : std::make_shared<MavQuadCopter>();
+
+    shared_ptr<DepthCamera> sensor;
+
+    if (opts.sensor == ST_REALSENSE) {
+#ifdef HAVE_REALSENSE
+        sensor = make_shared<RealSenseCamera>(640, 480, 30);
+#endif
+    } else if (opts.sensor == ST_GAZEBO_REALSENSE) {
+#ifdef HAVE_GAZEBO
+        sensor = make_shared<GazeboRealSenseCamera>();
+#endif
+    } else if (opts.sensor == ST_SIMULATED) {
+        vector<SimPillar> pillars;
+        if (!load_sim_world(opts.world, pillars)) {
+            exit(-EINVAL);
+        }
+
+        sensor = make_shared<SimulatedDepthCamera>(
+                [vehicle]() { return vehicle->vehicle_pose(); }, pillars,
+                320, 240, sim_fps);
+    }
+
+    if (opts.sensor == ST_UNDEFINED || sensor == nullptr) {
+        cerr << "ERROR: Invalid Sensor" << endl;
+        exit(-EINVAL);
+    }
+
+    shared_ptr<Detector> detector;
+    shared_ptr<DepthImagePolarHistDetector> polar_hist_detector;
+    switch (opts.detect) {
+        case DI_OBSTACLE:
+            detector = make_shared<DepthImageObstacleDetector>(5.0);
+            break;
+        case DI_POLAR_HIST:
+            polar_hist_detector = make_shared<DepthImagePolarHistDetector>(5);
+            detector = polar_hist_detector;
+            break;
+        case DI_UV_DISPARITY:
+            detector = make_shared<DepthImageUVDisparityDetector>(5.0);
+            break;
+        case DI_TTC:
+            detector = make_shared<DepthImageTTCDetector>();
+            break;
+        case DI_OBSTACLE_COARSE: {
+            shared_ptr<DepthImageObstacleDetector> obstacle_detector =
+                make_shared<DepthImageObstacleDetector>(5.0);
+            obstacle_detector->set_coarse_to_fine(4, 4.0);
+            detector = obstacle_detector;
+            break;
+        }
+        case DI_CORRIDOR:
+            detector = make_shared<DepthImageCorridorDetector>(4.0);
+            break;
+        default:
+            cerr << "ERROR: Invalid Detector" << endl;
+            exit(-EINVAL);
+    }
+
+    shared_ptr<CollisionAvoidanceStrategy<MavQuadCopter>> avoidance;
+    shared_ptr<DepthImageCollisionChecker> collision_checker;
+    switch(opts.avoidance) {
+        case QC_SHIFT_AVOIDANCE: {
+            shared_ptr<QuadCopterShiftAvoidance> shift_avoidance =
+                make_shared<QuadCopterShiftAvoidance>(vehicle);
+            collision_checker = make_shared<DepthImageCollisionChecker>();
+            shift_avoidance->set_collision_checker(collision_checker);
+            avoidance = shift_avoidance;
+            break;
+        }
+        case QC_STOP:
+            avoidance = make_shared<QuadCopterStopAvoidance>(vehicle);
+            break;
+        case QC_STOP_BRAKING: {
+            shared_ptr<QuadCopterStopAvoidance> stop_avoidance =
+                make_shared<QuadCopterStopAvoidance>(vehicle);
+            stop_avoidance->set_braking_model(2.5);
+            avoidance = stop_avoidance;
+            break;
+        }
+        case QC_VFF:
+            avoidance = make_shared<QuadCopterVFFAvoidance>(vehicle);
+            break;
+        case QC_VFH:
+            avoidance = make_shared<QuadCopterVFHAvoidance>(vehicle,
+                    sensor->get_horizontal_fov());
+            break;
+        case QC_DWA:
+            avoidance = make_shared<QuadCopterDWAAvoidance>(vehicle);
+            break;
+        case QC_DSTAR:
+            avoidance = make_shared<QuadCopterDStarAvoidance>(vehicle,
+                    sensor->get_horizontal_fov());
+            break;
+        case QC_VFF_VELOCITY:
+            avoidance = make_shared<QuadCopterVFFAvoidance>(vehicle, true);
+            break;
+        case QC_OFFLOAD:
+            if (!polar_hist_detector) {
+                cerr << "ERROR: QC_OFFLOAD requires DI_POLAR_HIST" << endl;
+                exit(-EINVAL);
+            }
+            avoidance = make_shared<QuadCopterOffloadAvoidance>(vehicle,
+                    polar_hist_detector);
+            break;
+        default:
+            cerr << "ERROR: Invalid Avoidance" << endl;
+            exit(-EINVAL);
+    }
+
+    Pipeline p;
+    p.vehicle = vehicle;
+    p.sensor = sensor;
+    p.detector = detector;
+    p.avoidance = avoidance;
+    p.collision_checker = collision_checker;
+
+    return p;
+}
+
+shared_ptr<DepthData> pipeline_sense(Pipeline &p)
+{
+    return p.sensor->read();
+}
+
+const vector<Obstacle> &pipeline_detect(Pipeline &p,
+        const control_options &opts, shared_ptr<DepthData> data)
+{
+    if (opts.roi_angle) {
+        p.detector->set_roi(direction_roi(p.vehicle->flight_direction(),
+                    glm::radians(opts.roi_angle)));
+    }
+
+    ScopedLatency timer(detect_latency);
+    return p.detector->detect(data);
+}
+
+void pipeline_avoid(Pipeline &p, shared_ptr<DepthData> data,
+        const vector<Obstacle> &obstacles)
+{
+    if (p.collision_checker) {
+        p.collision_checker->update(data);
+    }
+
+    p.avoidance->set_frame_time(data->timestamp);
+
+    ScopedLatency timer(avoid_latency);
+    p.avoidance->avoid(obstacles);
+}
+
+struct SensedFrame {
+    shared_ptr<DepthData> data;
+    steady_clock::time_point published;
+};
+
+struct DetectedFrame {
+    shared_ptr<DepthData> data;
+    vector<Obstacle> obstacles;
+    steady_clock::time_point published;
+};
+
+struct StageStats {
+    const char *name;
+
+    // Since the last report
+    atomic<uint64_t> frames;
+    // Inputs overwritten before the stage could take them
+    atomic<uint64_t> dropped;
+    // Time spent working and time inputs waited in the slot
+    atomic<uint64_t> busy_ns;
+    atomic<uint64_t> queue_ns;
+
+    StageStats(const char *name)
+        : name(name), frames(0), dropped(0), busy_ns(0), queue_ns(0)
+    {
+    }
+
+    void account(steady_clock::time_point queued, steady_clock::time_point start)
+    {
+        this->frames++;
+        this->queue_ns += duration_cast<nanoseconds>(start - queued).count();
+        this->busy_ns += duration_cast<nanoseconds>(
+                steady_clock::now() - start).count();
+    }
+
+    void print(double interval)
+    {
+        uint64_t frames = this->frames.exchange(0);
+        double busy = this->busy_ns.exchange(0) / 1e6;
+        double queue = this->queue_ns.exchange(0) / 1e6;
+
+        printf("[coav-control] %-6s %6.1f frames/s, %7.2f ms busy, "
+               "%7.2f ms queued, %lu dropped\n", this->name,
+               frames / interval, frames ? busy / frames : 0.0,
+               frames ? queue / frames : 0.0,
+               (unsigned long) this->dropped.exchange(0));
+    }
+};
+
+void run_pipelined(Pipeline &p, const control_options &opts)
+{
+    LatestSlot<SensedFrame> sensed;
+    LatestSlot<DetectedFrame> detected;
+    StageStats sense_stats("sense");
+    StageStats detect_stats("detect");
+    StageStats avoid_stats("avoid");
+
+    // From frame capture to the end of avoidance
+    LatencyHistogram frame_latency("pipeline.frame");
+
+    // The offload strategy reads the histogram of the detector, so it can
+    // not run while the detector works on the next frame
+    bool merge_avoid = opts.avoidance == QC_OFFLOAD;
+
+    auto avoid = [&](shared_ptr<DepthData> data, const vector<Obstacle> &obstacles,
+            steady_clock::time_point queued) {
+        steady_clock::time_point start = steady_clock::now();
+        pipeline_avoid(p, data, obstacles);
+        avoid_stats.account(queued, start);
+        frame_latency.record(steady_clock::now() - data->timestamp);
+    };
+
+    // Frames are not captured faster than the strategy uses them
+    thread sense_thread([&]() {
+        set_stage_realtime(opts, PS_SENSE);
+
+        DeadlineScheduler scheduler(p.avoidance->control_period());
+
+        while (true) {
+            scheduler.wait();
+
+            steady_clock::time_point start = steady_clock::now();
+            SensedFrame &out = sensed.back();
+            out.data = pipeline_sense(p);
+            out.published = steady_clock::now();
+            sense_stats.account(start, start);
+
+            if (!sensed.publish()) {
+                detect_stats.dropped++;
+            }
+        }
+    });
+
+    thread detect_thread([&]() {
+        set_stage_realtime(opts, PS_DETECT);
+
+        while (true) {
+            if (!sensed.wait(defaults::slot_timeout)) {
+                continue;
+            }
+
+            SensedFrame &in = sensed.front();
+            steady_clock::time_point start = steady_clock::now();
+            const vector<Obstacle> &obstacles = pipeline_detect(p, opts, in.data);
+            detect_stats.account(in.published, start);
+
+            if (merge_avoid) {
+                avoid(in.data, obstacles, steady_clock::now());
+                continue;
+            }
+
+            DetectedFrame &out = detected.back();
+            out.data = in.data;
+            out.obstacles = obstacles;
+            out.published = steady_clock::now();
+
+            if (!detected.publish()) {
+                avoid_stats.dropped++;
+            }
+        }
+    });
+
+    thread avoid_thread;
+    if (!merge_avoid) {
+        avoid_thread = thread([&]() {
+            set_stage_realtime(opts, PS_AVOID);
+
+            while (true) {
+                if (!detected.wait(defaults::slot_timeout)) {
+                    continue;
+                }
+
+                DetectedFrame &in = detected.front();
+                avoid(in.data, in.obstacles, in.published);
+            }
+        });
+    }
+
+    while (true) {
+        this_thread::sleep_for(defaults::stats_period);
+
+        if (opts.quiet) {
+            continue;
+        }
+
+        double interval = duration<double>(defaults::stats_period).count();
+
+        sense_stats.print(interval);
+        detect_stats.print(interval);
+        avoid_stats.print(interval);
+
+        printf("[coav-control] latency\n%s", latency_report().c_str());
+        fflush(stdout);
+    }
+}
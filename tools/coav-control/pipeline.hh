@@ -0,0 +1,107 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <coav/coav.hh>
+
+#include "coav-control.hh"
+
+/**
+ * Sensor, detector and avoidance strategy controlling one vehicle.
+ */
+struct Pipeline {
+    std::shared_ptr<MavQuadCopter> vehicle;
+    std::shared_ptr<DepthCamera> sensor;
+    std::shared_ptr<Detector> detector;
+    std::shared_ptr<CollisionAvoidanceStrategy<MavQuadCopter>> avoidance;
+    std::shared_ptr<DepthImageCollisionChecker> collision_checker;
+};
+
+/**
+ * @brief Build the pipeline selected on the command line. Exits on invalid
+ * options.
+ *
+ * @param port UDP port of the vehicle, 0 for the MavQuadCopter default.
+ * @param sim_fps Frame rate of ST_SIMULATED, 0 to render on demand.
+ */
+Pipeline make_pipeline(const control_options &opts, unsigned int port,
+        unsigned int sim_fps = 30);
+
+/**
+ * @brief Read a frame.
+ */
+std::shared_ptr<DepthData> pipeline_sense(Pipeline &p);
+
+/**
+ * @brief Detect the obstacles on a frame, after updating the region of
+ * interest. The result is only valid until the next call.
+ */
+const std::vector<Obstacle> &pipeline_detect(Pipeline &p,
+        const control_options &opts, std::shared_ptr<DepthData> data);
+
+/**
+ * @brief Run the avoidance strategy on the obstacles detected on a frame.
+ */
+void pipeline_avoid(Pipeline &p, std::shared_ptr<DepthData> data,
+        const std::vector<Obstacle> &obstacles);
+
+/**
+ * @brief Run sensing, detection and avoidance on a thread each, so a frame
+ * is captured while the previous one is still being processed. Stages are
+ * connected by LatestSlot: a stage always works on the newest output of
+ * the previous one and drops what it could not keep up with. Never
+ * returns.
+ */
+void run_pipelined(Pipeline &p, const control_options &opts);
+
+enum pipeline_stage {
+    PS_SENSE = 0,
+    PS_DETECT,
+    PS_AVOID,
+    PS_MAVLINK,
+};
+
+/**
+ * @brief Apply the real-time profile to the MAVLink thread and lock memory,
+ * if enabled, then run sensing and detection on a few frames to fault in
+ * their buffers. With 'opts.latency_frames', the latency of those frames
+ * is reported.
+ */
+void start_realtime_profile(Pipeline &p, const control_options &opts);
+
+/**
+ * @brief Pin the calling thread to the CPU of a stage and give it the
+ * stage's SCHED_FIFO priority, if the real-time profile is enabled.
+ */
+void set_stage_realtime(const control_options &opts, pipeline_stage stage);
+
+/**
+ * @brief Control 'opts.vehicles' vehicles, on consecutive ports, with their
+ * pipelines running as tasks on a shared thread pool. Never returns.
+ */
+void run_multi_vehicle(const control_options &opts);
+
+/**
+ * @brief Serve the latency histograms from a thread of their own: the
+ * report is printed on SIGUSR1 and written to every connection to the UNIX
+ * socket 'opts.stats_socket', if set. Must be called before any other
+ * thread is created.
+ */
+void start_stats_service(const control_options &opts);
@@ -0,0 +1,103 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <pthread.h>
+#include <thread>
+
+#include "pipeline.hh"
+
+using namespace std;
+
+namespace defaults
+{
+// SCHED_FIFO priorities. MAVLink I/O is short and latency critical, then
+// the stages closer to the vehicle command go first.
+const int stage_priority[] = {
+    65, // PS_SENSE
+    60, // PS_DETECT
+    70, // PS_AVOID
+    80, // PS_MAVLINK
+};
+// Frames run through sensing and detection at startup to fault in their
+// buffers, when no latency report is requested
+const unsigned int warmup_frames = 30;
+}
+
+static int stage_cpu(const control_options &opts, pipeline_stage stage)
+{
+    if (opts.rt_cpus.empty()) {
+        return -1;
+    }
+
+    // Stages past the end of the list share its last CPU
+    return opts.rt_cpus[min((size_t) stage, opts.rt_cpus.size() - 1)];
+}
+
+void set_stage_realtime(const control_options &opts, pipeline_stage stage)
+{
+    if (!opts.realtime) {
+        return;
+    }
+
+    int cpu = stage_cpu(opts, stage);
+    if (cpu >= 0) {
+        realtime_pin_thread(pthread_self(), cpu);
+    }
+
+    realtime_set_priority(pthread_self(), defaults::stage_priority[stage]);
+    realtime_prefault_stack();
+}
+
+void start_realtime_profile(Pipeline &p, const control_options &opts)
+{
+    if (opts.realtime) {
+        realtime_lock_memory();
+        p.vehicle->set_io_realtime(stage_cpu(opts, PS_MAVLINK),
+                defaults::stage_priority[PS_MAVLINK]);
+    }
+
+    unsigned int frames = opts.latency_frames;
+    if (!frames && opts.realtime) {
+        frames = defaults::warmup_frames;
+    }
+
+    if (!frames) {
+        return;
+    }
+
+    // Sensing and detection allocate their frame and workspace buffers on
+    // the first frames, so running a few faults them all in before the
+    // vehicle is controlled. The avoidance stage is left out, since it
+    // would send commands. Both stages record into their latency
+    // histograms, which hold only these frames so far.
+    thread measure([&]() {
+        set_stage_realtime(opts, PS_DETECT);
+
+        for (unsigned int i = 0; i < frames; i++) {
+            pipeline_detect(p, opts, pipeline_sense(p));
+        }
+    });
+    measure.join();
+
+    if (opts.latency_frames) {
+        printf("[coav-control] Startup latency over %u frames, real-time "
+               "profile %s\n%s", frames, opts.realtime ? "on" : "off",
+               latency_report().c_str());
+        fflush(stdout);
+    }
+}
@@ -0,0 +1,146 @@
+/*
+// Copyright (c) 2017 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <signal.h>
+#include <string>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+#include "pipeline.hh"
+
+using namespace std;
+
+static int listen_stats_socket(const string &path)
+{
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "[coav-control] stats socket path too long\n");
+        return -1;
+    }
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("[coav-control] error creating stats socket");
+        return -1;
+    }
+
+    // Remove the socket left behind by a previous run
+    unlink(path.c_str());
+
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+            listen(fd, 4) < 0) {
+        perror("[coav-control] error binding stats socket");
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static void write_report(int fd, const string &report)
+{
+    size_t written = 0;
+
+    while (written < report.size()) {
+        ssize_t ret = write(fd, report.data() + written,
+                report.size() - written);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            return;
+        }
+        written += ret;
+    }
+}
+
+static void stats_service(int signal_fd, int listen_fd)
+{
+    struct pollfd fds[2] = {
+        {signal_fd, POLLIN, 0},
+        {listen_fd, POLLIN, 0},
+    };
+    // A negative fd is ignored by poll()
+    nfds_t nfds = listen_fd < 0 ? 1 : 2;
+
+    while (true) {
+        if (poll(fds, nfds, -1) < 0) {
+            if (errno != EINTR) {
+                perror("[coav-control] error waiting for stats requests");
+                return;
+            }
+            continue;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            struct signalfd_siginfo info;
+            ssize_t ret = read(signal_fd, &info, sizeof(info));
+            (void) ret;
+
+            printf("[coav-control] latency\n%s", latency_report().c_str());
+            fflush(stdout);
+        }
+
+        if (nfds > 1 && (fds[1].revents & POLLIN)) {
+            int client = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0) {
+                continue;
+            }
+
+            write_report(client, latency_report());
+            close(client);
+        }
+    }
+}
+
+void start_stats_service(const control_options &opts)
+{
+    // Signals are handled by a thread of their own through a signalfd, so
+    // SIGUSR1 has to be blocked before any other thread inherits the mask
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGUSR1);
+
+    if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) != 0) {
+        fprintf(stderr, "[coav-control] error blocking SIGUSR1\n");
+        return;
+    }
+
+    int signal_fd = signalfd(-1, &mask, SFD_CLOEXEC);
+    if (signal_fd < 0) {
+        perror("[coav-control] error creating signalfd");
+        return;
+    }
+
+    int listen_fd = -1;
+    if (!opts.stats_socket.empty()) {
+        listen_fd = listen_stats_socket(opts.stats_socket);
+    }
+
+    // Runs with the default scheduling policy, and histograms are read
+    // without locks, so serving a request never stalls the control loop
+    thread(stats_service, signal_fd, listen_fd).detach();
+}